@@ -0,0 +1,182 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../src/hpack/hpack.h"
+#include "../src/hpack/header_list.h"
+#include "../src/hpack/huffman.h"
+#include "hpack_corpus.h"
+
+/*
+    Runs the HPACK encoder and decoders and the Huffman coder over the
+    header lists in hpack_corpus.h. Every pass starts from empty tables and
+    goes through the lists in order, as a new connection would, with the
+    encoder set up the way Connection sets it up.
+
+    Reported per header: the time to encode, to decode into
+    HeaderFieldRepresentations and into a HeaderList, and the raw and
+    encoded octets, whose quotient is the compression ratio.
+
+    usage: hpack_bench [iterations]
+*/
+
+typedef std::vector<hpack::HeaderFieldRepresentation> HeaderVector;
+
+static void LoadLists(const struct CorpusField* fields, std::vector<HeaderVector>& lists, size_t& headers, size_t& raw_bytes) {
+    HeaderVector list;
+
+    for(; ; fields++) {
+        if(fields->name == nullptr) {
+            if(list.empty() == true) break;
+            lists.push_back(list);
+            list.clear();
+            continue;
+        }
+
+        hpack::HeaderFieldRepresentation header;
+        header.Field().SetName(std::string(fields->name));
+        header.Field().SetValue(std::string(fields->value));
+        header.Type() = hpack::HeaderField::INDEXED_HEADER_FIELD;
+        list.push_back(header);
+
+        headers = headers + 1;
+        raw_bytes = raw_bytes + header.Field().Name().length() + header.Field().Value().length();
+    }
+}
+
+static double NanosecondsSince(const std::chrono::steady_clock::time_point& start) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e9;
+}
+
+static bool BenchLists(const char* name, const std::vector<HeaderVector>& lists, size_t headers, size_t raw_bytes, int iterations) {
+    std::vector<Buffer> blocks;
+    size_t encoded_bytes = 0, i, j;
+    std::chrono::steady_clock::time_point start;
+    double encode_ns, decode_ns, list_decode_ns;
+    Buffer block;
+    HeaderVector decoded;
+    hpack::HeaderList header_list;
+
+    {
+        hpack::Table encoder, decoder;
+        encoder.SetHuffmanMode(hpack::Table::HUFFMAN_ADAPTIVE);
+        for(i = 0; i < lists.size(); i++) {
+            encoder.Encode(block, lists[i]);
+            encoded_bytes = encoded_bytes + block.Length();
+            blocks.push_back(block);
+
+            decoded.clear();
+            if(decoder.Decode(decoded, block) == false || decoded.size() != lists[i].size()) return false;
+            for(j = 0; j < decoded.size(); j++) {
+                if(decoded[j].Field().Name() != lists[i][j].Field().Name() || decoded[j].Field().Value() != lists[i][j].Field().Value()) return false;
+            }
+        }
+    }
+
+    start = std::chrono::steady_clock::now();
+    for(int n = 0; n < iterations; n++) {
+        hpack::Table encoder;
+        encoder.SetHuffmanMode(hpack::Table::HUFFMAN_ADAPTIVE);
+        for(i = 0; i < lists.size(); i++) encoder.Encode(block, lists[i]);
+    }
+    encode_ns = NanosecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int n = 0; n < iterations; n++) {
+        hpack::Table decoder;
+        for(i = 0; i < blocks.size(); i++) {
+            decoded.clear();
+            decoder.Decode(decoded, blocks[i]);
+        }
+    }
+    decode_ns = NanosecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int n = 0; n < iterations; n++) {
+        hpack::Table decoder;
+        for(i = 0; i < blocks.size(); i++) {
+            header_list.Clear();
+            decoder.Decode(header_list, blocks[i]);
+        }
+    }
+    list_decode_ns = NanosecondsSince(start);
+
+    double count = (double)headers * iterations;
+    std::cout << name << ": " << lists.size() << " lists, " << headers << " headers, " \
+        << (double)raw_bytes / headers << " -> " << (double)encoded_bytes / headers << " bytes/header, ratio " \
+        << (double)raw_bytes / encoded_bytes << std::endl;
+    std::cout << "    encode " << encode_ns / count << " ns/header, decode " << decode_ns / count \
+        << " ns/header, decode to HeaderList " << list_decode_ns / count << " ns/header" << std::endl;
+    return true;
+}
+
+static bool BenchHuffman(const std::vector<std::string>& values, int iterations) {
+    std::vector<Buffer> encoded;
+    Buffer code, decoded;
+    size_t raw_bytes = 0, encoded_bytes = 0, i;
+    std::chrono::steady_clock::time_point start;
+    double encode_ns, decode_ns;
+
+    for(i = 0; i < values.size(); i++) {
+        hpack::Huffman::Encode(code, BufferView(values[i].data(), values[i].length()));
+        if(hpack::Huffman::Decode(decoded, code) == false || BufferView(decoded).Equals(BufferView(values[i].data(), values[i].length())) == false) return false;
+        raw_bytes = raw_bytes + values[i].length();
+        encoded_bytes = encoded_bytes + code.Length();
+        encoded.push_back(code);
+    }
+
+    start = std::chrono::steady_clock::now();
+    for(int n = 0; n < iterations; n++) {
+        for(i = 0; i < values.size(); i++) hpack::Huffman::Encode(code, BufferView(values[i].data(), values[i].length()));
+    }
+    encode_ns = NanosecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int n = 0; n < iterations; n++) {
+        for(i = 0; i < encoded.size(); i++) hpack::Huffman::Decode(decoded, encoded[i]);
+    }
+    decode_ns = NanosecondsSince(start);
+
+    double bytes = (double)raw_bytes * iterations;
+    std::cout << "huffman: " << values.size() << " strings, ratio " << (double)raw_bytes / encoded_bytes \
+        << ", encode " << encode_ns / bytes << " ns/byte, decode " << decode_ns / bytes << " ns/byte" << std::endl;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? std::stoi(argv[1]) : 20000;
+    std::vector<std::string> values;
+    size_t i, j, k;
+
+    hpack::Huffman::GetInstance();
+
+    for(i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+        const struct CorpusField* directions[] = { corpora[i].requests, corpora[i].responses };
+        const char* direction_names[] = { "requests", "responses" };
+
+        for(j = 0; j < 2; j++) {
+            std::vector<HeaderVector> lists;
+            size_t headers = 0, raw_bytes = 0;
+            std::string name = std::string(corpora[i].name) + " " + direction_names[j];
+
+            LoadLists(directions[j], lists, headers, raw_bytes);
+            if(BenchLists(name.c_str(), lists, headers, raw_bytes, iterations) == false) {
+                std::cerr << "round trip mismatch: " << name << std::endl;
+                return 1;
+            }
+
+            for(k = 0; directions[j][k].name != nullptr || directions[j][k + 1].name != nullptr; k++) {
+                if(directions[j][k].name != nullptr) values.push_back(directions[j][k].value);
+            }
+        }
+    }
+
+    if(BenchHuffman(values, iterations / 10 + 1) == false) {
+        std::cerr << "huffman round trip mismatch" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
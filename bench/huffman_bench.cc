@@ -0,0 +1,74 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../src/hpack/huffman.h"
+
+/*
+    Compares the table driven Huffman decoder with the bit-at-a-time tree
+    walker on Huffman encoded header values of the kind browsers send.
+
+    usage: huffman_bench [iterations]
+*/
+
+static const char* samples[] = {
+    "/",
+    "/index.html",
+    "/static/js/main.3f2a9c1b.chunk.js",
+    "/api/v2/users/1024/notifications?limit=50&offset=100&sort=-created_at",
+    "/search?q=http2+header+compression&hl=en&source=hp&ei=Zy3kYqLpJ4mSjLsP",
+    "www.example.com",
+    "gzip, deflate, br",
+    "en-US,en;q=0.9,ko;q=0.8",
+    "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8",
+    "max-age=0",
+    "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36",
+    "Mozilla/5.0 (iPhone; CPU iPhone OS 17_0 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.0 Mobile/15E148 Safari/604.1",
+    "_ga=GA1.2.1180745390.1697000000; _gid=GA1.2.2068817531.1697400000; session_id=9f8e7d6c5b4a39281706f5e4d3c2b1a0; theme=dark; lang=en",
+    "csrftoken=Q2xhdWRlIGlzIG5vdCB3cml0aW5nIHRoaXM; sessionid=abcdefghijklmnopqrstuvwxyz012345",
+    "Wed, 11 Oct 2023 07:28:00 GMT",
+    "\"33a64df551425fcc55e4d42a148795d9f25f89d4\"",
+    "https://www.example.com/products/category/shoes?color=black&size=42",
+};
+
+int main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? std::stoi(argv[1]) : 200000;
+    std::vector<Buffer> encoded;
+    Buffer decoded, expected;
+    size_t encoded_bytes = 0, i;
+
+    hpack::Huffman::GetInstance();
+
+    for(i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        Buffer code;
+        hpack::Huffman::Encode(code, Buffer(samples[i]));
+        encoded_bytes = encoded_bytes + code.Length();
+        encoded.push_back(std::move(code));
+    }
+
+    for(i = 0; i < encoded.size(); i++) {
+        if(hpack::Huffman::Decode(decoded, encoded[i]) == false || BufferView(decoded).Equals(Buffer(samples[i])) == false) {
+            std::cerr << "decode mismatch: " << samples[i] << std::endl;
+            return 1;
+        }
+    }
+
+    const char* names[] = { "tree walker", "state machine" };
+    for(int decoder = 0; decoder < 2; decoder++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for(int n = 0; n < iterations; n++) {
+            for(i = 0; i < encoded.size(); i++) {
+                if(decoder == 0) hpack::Huffman::DecodeTree(decoded, encoded[i]);
+                else hpack::Huffman::Decode(decoded, encoded[i]);
+            }
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double bytes = (double)encoded_bytes * iterations;
+        std::cout << names[decoder] << ": " << elapsed.count() * 1e9 / bytes << " ns/byte, " << bytes / elapsed.count() / (1 << 20) << " MiB/s" << std::endl;
+    }
+
+    return 0;
+}
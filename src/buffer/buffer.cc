@@ -6,10 +6,6 @@
 #include "buffer.h"
 
 Buffer::Buffer() {
-    len = 0;
-    max_len = 8;
-    buffer = (char *)malloc(sizeof(char) * max_len);
-    memset(buffer, 0, max_len);
 }
 
 Buffer::Buffer(const unsigned int buff_len) {
@@ -19,21 +15,33 @@ Buffer::Buffer(const unsigned int buff_len) {
 }
 
 Buffer::Buffer(const char* str) {
-    UpdateBufferSize(strlen(str));
-    memset(buffer, 0, max_len);
-    strncpy(buffer, str, strlen(str));
-    len = strlen(str);
+    Copy(str, strlen(str));
 }
 
 Buffer::Buffer(const char* str, const unsigned int str_len) {
-    UpdateBufferSize(str_len);
-    memset(buffer, 0, max_len);
-    memcpy(buffer, str, str_len);
-    len = str_len;
+    Copy(str, str_len);
+}
+
+Buffer::Buffer(const struct Buffer& a) {
+    Copy(a);
+}
+
+Buffer::Buffer(struct Buffer&& a) {
+    if(a.IsInline()) {
+        memcpy(buffer, a.buffer, a.len);
+    }
+    else {
+        buffer = a.buffer;
+        max_len = a.max_len;
+        a.buffer = a.inline_buffer;
+        a.max_len = BUFFER_INLINE_SIZE;
+    }
+    len = a.len;
+    a.len = 0;
 }
 
 Buffer::~Buffer() {
-    if(buffer != nullptr) free(buffer);
+    if(IsInline() == false) free(buffer);
 }
 
 void Buffer::Append(const struct Buffer& a) {
@@ -48,6 +56,10 @@ void Buffer::Append(const char ch) {
     Copy(ch, len);
 }
 
+void Buffer::Append(const struct BufferView& a) {
+    Copy(a, len);
+}
+
 void Buffer::Copy(const struct Buffer& a, const unsigned int at) {
     if(max_len < at + a.len) UpdateBufferSize(at + a.len);
     memcpy(buffer + at, a.buffer, a.len);
@@ -64,19 +76,33 @@ void Buffer::Copy(const char ch, const unsigned int at) {
     Set(ch, at);
 }
 
+void Buffer::Copy(const struct BufferView& a, const unsigned int at) {
+    if(max_len < at + a.Length()) UpdateBufferSize(at + a.Length());
+    if(a.Length() > 0) memcpy(buffer + at, a.Address(), a.Length());
+    len = at + a.Length();
+}
+
+void Buffer::Reserve(const unsigned int buff_len) {
+    if(max_len < buff_len) UpdateBufferSize(buff_len);
+}
+
 void Buffer::Resize(const unsigned int buff_len) {
-    UpdateBufferSize(buff_len);
+    if(max_len < buff_len) UpdateBufferSize(buff_len);
     len = buff_len;
 }
 
 void Buffer::Clear() {
-    Resize(0);
+    len = 0;
 }
 
 unsigned int Buffer::Length() const {
     return len;
 }
 
+unsigned int Buffer::Capacity() const {
+    return max_len;
+}
+
 const char* Buffer::Address(const unsigned int idx) const {
     if(idx >= len) return nullptr;
     return buffer + idx;
@@ -92,12 +118,7 @@ void Buffer::Set(const char ch, const unsigned int idx) {
 }
 
 uint64_t Buffer::GetValue(const unsigned int bytes, const unsigned int idx) const {
-    if(bytes > 8) return 0;
-    uint64_t value = 0;
-    for(int i = 0; i < bytes; i++) {
-        value = (value << 8) | buffer[i + idx];
-    }
-    return value;
+    return BufferView(*this).GetValue(bytes, idx);
 }
 
 bool Buffer::SetValue(const uint64_t value, const int bytes, const unsigned int idx) {
@@ -121,16 +142,36 @@ char& Buffer::operator[](const unsigned int i) {
 }
 
 struct Buffer& Buffer::operator=(const struct Buffer& a) {
-    UpdateBufferSize(a.len);
+    if(this == &a) return *this;
+    if(max_len < a.len) UpdateBufferSize(a.len);
     memcpy(buffer, a.buffer, a.len);
     len = a.len;
     return *this;
 }
 
+struct Buffer& Buffer::operator=(struct Buffer&& a) {
+    if(this == &a) return *this;
+
+    // Inline contents are cheap to copy, and a heap block of our own is reused.
+    if(a.IsInline() || (IsInline() == false && a.len <= max_len)) {
+        memcpy(buffer, a.buffer, a.len);
+        len = a.len;
+        a.len = 0;
+        return *this;
+    }
+
+    if(IsInline() == false) free(buffer);
+    buffer = a.buffer;
+    max_len = a.max_len;
+    len = a.len;
+    a.buffer = a.inline_buffer;
+    a.max_len = BUFFER_INLINE_SIZE;
+    a.len = 0;
+    return *this;
+}
+
 struct Buffer& Buffer::operator=(const char* str) {
-    UpdateBufferSize(strlen(str));
-    memcpy(buffer, str, strlen(str));
-    len = strlen(str);
+    Copy(str, strlen(str));
     return *this;
 }
 
@@ -176,12 +217,29 @@ struct Buffer& Buffer::operator+=(const char ch) {
     return *this;
 }
 
+// Grows the capacity to at least min, doubling it so appends stay amortized O(1).
+// Capacity never shrinks.
 void Buffer::UpdateBufferSize(const unsigned int min) {
-    max_len = 8;
-    while(max_len < min) {
-        max_len = max_len * 2;
+    unsigned int new_len = max_len;
+
+    while(new_len < min) {
+        new_len = new_len * 2;
+    }
+    if(new_len == max_len) return;
+
+    if(IsInline()) {
+        char* new_buffer = (char *)malloc(sizeof(char) * new_len);
+        memcpy(new_buffer, buffer, max_len);
+        buffer = new_buffer;
+    }
+    else {
+        buffer = (char *)realloc(buffer, sizeof(char) * new_len);
     }
-    buffer = (char *)realloc(buffer, sizeof(char) * max_len);
+    max_len = new_len;
+}
+
+bool Buffer::IsInline() const {
+    return buffer == inline_buffer;
 }
 
 void Buffer::PrintBuffer(const char* buff, const int len) {
@@ -201,6 +259,68 @@ void Buffer::PrintBuffer(const char* buff, const int len) {
     }
 }
 
+BufferView::BufferView() {
+}
+
+BufferView::BufferView(const char* buff, const unsigned int buff_len) : buffer(buff), len(buff_len) {
+}
+
+BufferView::BufferView(const struct Buffer& buff) : buffer(buff.Address()), len(buff.Length()) {
+}
+
+unsigned int BufferView::Length() const {
+    return len;
+}
+
+bool BufferView::Empty() const {
+    return len == 0;
+}
+
+const char* BufferView::Address(const unsigned int idx) const {
+    if(idx >= len) return nullptr;
+    return buffer + idx;
+}
+
+char BufferView::Get(const unsigned int idx) const {
+    if(idx >= len) return '\0';
+    return buffer[idx];
+}
+
+// Reads a big-endian unsigned integer of the given width.
+uint64_t BufferView::GetValue(const unsigned int bytes, const unsigned int idx) const {
+    if(bytes > 8 || idx > len || bytes > len - idx) return 0;
+    uint64_t value = 0;
+    for(unsigned int i = 0; i < bytes; i++) {
+        value = (value << 8) | (uint8_t)buffer[i + idx];
+    }
+    return value;
+}
+
+struct BufferView BufferView::Slice(const unsigned int idx) const {
+    if(idx >= len) return BufferView();
+    return BufferView(buffer + idx, len - idx);
+}
+
+struct BufferView BufferView::Slice(const unsigned int idx, const unsigned int slice_len) const {
+    if(idx >= len) return BufferView();
+    if(slice_len > len - idx) return BufferView(buffer + idx, len - idx);
+    return BufferView(buffer + idx, slice_len);
+}
+
+bool BufferView::Equals(const struct BufferView& a) const {
+    if(len != a.len) return false;
+    if(len == 0) return true;
+    return memcmp(buffer, a.buffer, len) == 0;
+}
+
+void BufferView::Print() const {
+    Buffer::PrintBuffer(buffer, len);
+}
+
+char BufferView::operator[](const unsigned int i) const {
+    return buffer[i];
+}
+
 uint24_t& uint24_t::operator=(const uint32_t& value) {
     value_ = 0x00FFFFFF & value;
 }
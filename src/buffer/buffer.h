@@ -3,24 +3,43 @@
 
 #include <cstdint>
 
+// Contents up to this size are kept inside the Buffer itself without a heap allocation.
+#define BUFFER_INLINE_SIZE 32
+
+struct BufferView;
+
+/*
+    ### Buffer ###
+    Owning byte buffer. Small contents live in an inline region, larger ones
+    on the heap. Capacity grows geometrically and is kept across Resize() and
+    Clear(), so a reused Buffer stops allocating once it is large enough.
+    Moving a Buffer hands over its heap block instead of copying it.
+*/
+
 struct Buffer {
 public:
     Buffer();
     Buffer(const unsigned int buff_len);
     Buffer(const char* str);
     Buffer(const char* str, const unsigned int str_len);
+    Buffer(const struct Buffer& a);
+    Buffer(struct Buffer&& a);
     ~Buffer();
 
     void Append(const struct Buffer& a);
     void Append(const char* buff, const unsigned int buff_len);
     void Append(const char ch);
+    void Append(const struct BufferView& a);
 
     void Copy(const struct Buffer& a, const unsigned int at = 0);
     void Copy(const char* buff, const unsigned int buff_len, const unsigned int at = 0);
     void Copy(const char ch, const unsigned int at = 0);
+    void Copy(const struct BufferView& a, const unsigned int at = 0);
 
     unsigned int Length() const;
+    unsigned int Capacity() const;
 
+    void Reserve(const unsigned int buff_len);
     void Resize(const unsigned int buff_len);
     void Clear();
 
@@ -37,6 +56,7 @@ public:
     char& operator[](const unsigned int i);
 
     struct Buffer& operator=(const struct Buffer& a);
+    struct Buffer& operator=(struct Buffer&& a);
     struct Buffer& operator=(const char* str);
 
     struct Buffer& operator+(const struct Buffer& a);
@@ -51,10 +71,49 @@ public:
 
 private:
     void UpdateBufferSize(const unsigned int min);
+    bool IsInline() const;
+
+    char* buffer = inline_buffer;
+    unsigned int len = 0;
+    unsigned int max_len = BUFFER_INLINE_SIZE;
+    char inline_buffer[BUFFER_INLINE_SIZE];
+};
+
+/*
+    ### BufferView ###
+    Non-owning slice of memory owned by a Buffer, a RingBuffer or a plain
+    array. Copying a view never copies the bytes, so the owner must outlive
+    every view taken from it and must not reallocate while one is in use.
+    A Buffer converts to a view of its whole contents.
+
+    Reads past the end of the view return 0, and slices are clamped to it.
+*/
+struct BufferView {
+public:
+    BufferView();
+    BufferView(const char* buff, const unsigned int buff_len);
+    BufferView(const struct Buffer& buff);
+
+    unsigned int Length() const;
+    bool Empty() const;
 
-    char* buffer = nullptr;
+    const char* Address(const unsigned int idx = 0) const;
+
+    char Get(const unsigned int idx) const;
+    uint64_t GetValue(const unsigned int bytes, const unsigned int idx) const;
+
+    struct BufferView Slice(const unsigned int idx) const;
+    struct BufferView Slice(const unsigned int idx, const unsigned int slice_len) const;
+
+    bool Equals(const struct BufferView& a) const;
+
+    void Print() const;
+
+    char operator[](const unsigned int i) const;
+
+private:
+    const char* buffer = nullptr;
     unsigned int len = 0;
-    unsigned int max_len = 8;
 };
 
 struct uint24_t {
@@ -0,0 +1,178 @@
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sys/uio.h>
+
+#include "buffer_chain.h"
+
+// iovecs handed to one writev() call by WriteTo().
+#define BUFFER_CHAIN_IOV_MAX 64
+
+BufferChain::BufferChain() {
+}
+
+BufferChain::BufferChain(const unsigned int block_size) : block_size(block_size > 0 ? block_size : BUFFER_CHAIN_BLOCK_SIZE) {
+}
+
+BufferChain::~BufferChain() {
+    Clear();
+    if(spare_block != nullptr) free(spare_block);
+}
+
+void BufferChain::Append(const char* buff, const unsigned int buff_len) {
+    unsigned int copied = 0, room;
+
+    while(copied < buff_len) {
+        if(first_block == blocks.size() || blocks.back().end == block_size) {
+            struct Block block = { AllocateBlock(), 0, 0 };
+            blocks.push_back(block);
+        }
+
+        struct Block& block = blocks.back();
+        room = block_size - block.end;
+        if(room > buff_len - copied) room = buff_len - copied;
+
+        memcpy(block.buffer + block.end, buff + copied, room);
+        block.end = block.end + room;
+        copied = copied + room;
+    }
+
+    len = len + buff_len;
+}
+
+void BufferChain::Append(const struct BufferView& a) {
+    if(a.Empty()) return;
+    Append(a.Address(), a.Length());
+}
+
+void BufferChain::Consume(const unsigned int consume_len) {
+    unsigned int remain = (consume_len < len) ? consume_len : len, taken;
+
+    len = len - remain;
+
+    while(remain > 0) {
+        struct Block& block = blocks[first_block];
+        taken = block.end - block.begin;
+        if(taken > remain) taken = remain;
+
+        block.begin = block.begin + taken;
+        remain = remain - taken;
+
+        if(block.begin < block.end) break;
+
+        // An emptied last block is rewound and kept for the next append.
+        if(first_block + 1 == blocks.size()) {
+            block.begin = 0;
+            block.end = 0;
+            break;
+        }
+
+        FreeBlock(block.buffer);
+        first_block++;
+    }
+
+    if(first_block > 64 && first_block * 2 > blocks.size()) {
+        blocks.erase(blocks.begin(), blocks.begin() + first_block);
+        first_block = 0;
+    }
+}
+
+unsigned int BufferChain::Length() const {
+    return len;
+}
+
+unsigned int BufferChain::BlockSize() const {
+    return block_size;
+}
+
+bool BufferChain::Empty() const {
+    return len == 0;
+}
+
+// Fills iov with the readable regions in order and returns how many were used.
+int BufferChain::ExportIovec(struct iovec* iov, const int iov_len) const {
+    int cnt = 0;
+
+    for(size_t i = first_block; i < blocks.size() && cnt < iov_len; i++) {
+        if(blocks[i].begin == blocks[i].end) continue;
+        iov[cnt].iov_base = blocks[i].buffer + blocks[i].begin;
+        iov[cnt].iov_len = blocks[i].end - blocks[i].begin;
+        cnt++;
+    }
+
+    return cnt;
+}
+
+// Appends views of at most max_len bytes covering the readable bytes in order,
+// or only the first limit bytes if limit is not 0. Views never cross a block
+// boundary, so they are no longer than the block size even when max_len is.
+// Returns the number of bytes covered.
+unsigned int BufferChain::Split(std::vector<struct BufferView>& views, const unsigned int max_len, const unsigned int limit) const {
+    unsigned int total = 0, want = (limit > 0 && limit < len) ? limit : len, at, piece;
+
+    if(max_len == 0) return 0;
+
+    for(size_t i = first_block; i < blocks.size() && total < want; i++) {
+        at = blocks[i].begin;
+        while(at < blocks[i].end && total < want) {
+            piece = blocks[i].end - at;
+            if(piece > max_len) piece = max_len;
+            if(piece > want - total) piece = want - total;
+
+            views.push_back(BufferView(blocks[i].buffer + at, piece));
+            at = at + piece;
+            total = total + piece;
+        }
+    }
+
+    return total;
+}
+
+// Writes as much as the socket accepts and consumes it.
+// Returns the number of bytes written, or -1 on error.
+int BufferChain::WriteTo(const int fd) {
+    struct iovec iov[BUFFER_CHAIN_IOV_MAX];
+    int iov_cnt, total = 0;
+    ssize_t written;
+
+    while(len > 0) {
+        iov_cnt = ExportIovec(iov, BUFFER_CHAIN_IOV_MAX);
+
+        written = ::writev(fd, iov, iov_cnt);
+        if(written < 0) {
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+
+        Consume(written);
+        total = total + written;
+    }
+
+    return total;
+}
+
+void BufferChain::Clear() {
+    for(size_t i = first_block; i < blocks.size(); i++) {
+        FreeBlock(blocks[i].buffer);
+    }
+    blocks.clear();
+    first_block = 0;
+    len = 0;
+}
+
+char* BufferChain::AllocateBlock() {
+    char* block = spare_block;
+
+    if(block != nullptr) {
+        spare_block = nullptr;
+        return block;
+    }
+
+    return (char *)malloc(sizeof(char) * block_size);
+}
+
+void BufferChain::FreeBlock(char* block) {
+    if(spare_block == nullptr) spare_block = block;
+    else free(block);
+}
@@ -0,0 +1,65 @@
+#ifndef _LHTTP2_BUFFER_CHAIN_H_
+#define _LHTTP2_BUFFER_CHAIN_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "buffer.h"
+
+#define BUFFER_CHAIN_BLOCK_SIZE 16384
+
+struct iovec;
+
+/*
+    Segmented byte buffer for large bodies. Bytes are appended into a chain
+    of fixed size blocks, so growing the chain never moves what is already
+    in it, and consuming a prefix frees whole blocks without shifting the
+    rest. The last freed block is kept for the next append.
+
+    The readable bytes can be exported as an iovec array for writev(), or
+    split into contiguous views no longer than a frame so each one can be
+    sent as the data of a DATA frame. Views stay valid until the bytes they
+    cover are consumed.
+*/
+struct BufferChain {
+public:
+    BufferChain();
+    BufferChain(const unsigned int block_size);
+    ~BufferChain();
+
+    BufferChain(const struct BufferChain&) = delete;
+    struct BufferChain& operator=(const struct BufferChain&) = delete;
+
+    void Append(const char* buff, const unsigned int buff_len);
+    void Append(const struct BufferView& a);
+
+    void Consume(const unsigned int len);
+
+    unsigned int Length() const;
+    unsigned int BlockSize() const;
+    bool Empty() const;
+
+    int ExportIovec(struct iovec* iov, const int iov_len) const;
+    unsigned int Split(std::vector<struct BufferView>& views, const unsigned int max_len, const unsigned int limit = 0) const;
+
+    int WriteTo(const int fd);
+    void Clear();
+
+private:
+    struct Block {
+        char* buffer;
+        unsigned int begin;
+        unsigned int end;
+    };
+
+    char* AllocateBlock();
+    void FreeBlock(char* block);
+
+    std::vector<struct Block> blocks;
+    size_t first_block = 0;
+    unsigned int block_size = BUFFER_CHAIN_BLOCK_SIZE;
+    unsigned int len = 0;
+    char* spare_block = nullptr;
+};
+
+#endif
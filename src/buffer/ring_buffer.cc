@@ -0,0 +1,157 @@
+#include <cstdlib>
+#include <cstring>
+#include <sys/uio.h>
+
+#include "ring_buffer.h"
+
+RingBuffer::RingBuffer() {
+}
+
+RingBuffer::RingBuffer(const unsigned int buff_len) {
+    Reserve(buff_len);
+}
+
+RingBuffer::~RingBuffer() {
+    if(buffer != nullptr) free(buffer);
+}
+
+int RingBuffer::ReadFrom(const int fd) {
+    struct iovec iov[2];
+    unsigned int mask = capacity - 1, free_len = Available(), at, first;
+    int iov_cnt = 1, len;
+
+    if(free_len == 0) return 0;
+
+    at = tail & mask;
+    first = capacity - at;
+    if(first > free_len) first = free_len;
+
+    iov[0].iov_base = buffer + at;
+    iov[0].iov_len = first;
+
+    if(first < free_len) {
+        iov[1].iov_base = buffer;
+        iov[1].iov_len = free_len - first;
+        iov_cnt = 2;
+    }
+
+    len = ::readv(fd, iov, iov_cnt);
+    if(len > 0) tail = tail + len;
+
+    return len;
+}
+
+const char* RingBuffer::Peek(unsigned int& len) const {
+    unsigned int at = head & (capacity - 1);
+
+    len = Length();
+    if(len > capacity - at) len = capacity - at;
+
+    if(len == 0) return nullptr;
+    return buffer + at;
+}
+
+void RingBuffer::Consume(const unsigned int len) {
+    if(len >= Length() && Pinned() == false) {
+        // Rewind an empty ring so the next read lands in one contiguous region.
+        head = 0;
+        tail = 0;
+        return;
+    }
+    head = head + (len < Length() ? len : Length());
+}
+
+unsigned int RingBuffer::Length() const {
+    return tail - head;
+}
+
+unsigned int RingBuffer::Capacity() const {
+    return capacity;
+}
+
+unsigned int RingBuffer::Available() const {
+    return capacity - (tail - Low());
+}
+
+// Pins the byte at address, which must lie in the readable region.
+// Returns the position to pass to Unpin().
+uint64_t RingBuffer::Pin(const char* address) {
+    unsigned int mask = capacity - 1;
+    uint64_t position = head + (((address - buffer) - (head & mask)) & mask);
+
+    if(pins.size() > first_pin && pins.back().position == position) {
+        pins.back().count++;
+    }
+    else {
+        struct PinEntry pin = { position, 1 };
+        pins.push_back(pin);
+    }
+
+    return position;
+}
+
+void RingBuffer::Unpin(const uint64_t position) {
+    size_t low = first_pin, high = pins.size(), mid;
+
+    // Pins are taken in parsing order, so positions are sorted.
+    while(low < high) {
+        mid = (low + high) / 2;
+        if(pins[mid].position < position) low = mid + 1;
+        else high = mid;
+    }
+
+    if(low == pins.size() || pins[low].position != position || pins[low].count == 0) return;
+
+    pins[low].count--;
+
+    while(first_pin < pins.size() && pins[first_pin].count == 0) {
+        first_pin++;
+    }
+
+    if(first_pin == pins.size()) {
+        pins.clear();
+        first_pin = 0;
+        if(head == tail) Clear();
+    }
+}
+
+bool RingBuffer::Pinned() const {
+    return first_pin < pins.size();
+}
+
+void RingBuffer::Reserve(const unsigned int min) {
+    unsigned int new_capacity = 8, len = Length(), first;
+    char* new_buffer;
+
+    while(new_capacity < min) {
+        new_capacity = new_capacity * 2;
+    }
+
+    // Pinned bytes must stay where they are.
+    if(new_capacity <= capacity || Pinned()) return;
+
+    new_buffer = (char *)malloc(sizeof(char) * new_capacity);
+
+    if(len > 0) {
+        const char* data = Peek(first);
+        memcpy(new_buffer, data, first);
+        memcpy(new_buffer + first, buffer, len - first);
+    }
+
+    if(buffer != nullptr) free(buffer);
+
+    buffer = new_buffer;
+    capacity = new_capacity;
+    head = 0;
+    tail = len;
+}
+
+void RingBuffer::Clear() {
+    head = 0;
+    tail = 0;
+}
+
+uint64_t RingBuffer::Low() const {
+    if(Pinned() && pins[first_pin].position < head) return pins[first_pin].position;
+    return head;
+}
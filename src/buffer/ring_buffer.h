@@ -0,0 +1,61 @@
+#ifndef _LHTTP2_RING_BUFFER_H_
+#define _LHTTP2_RING_BUFFER_H_
+
+#include <cstdint>
+#include <vector>
+
+/*
+    Fixed capacity byte ring used as the receive buffer of a connection.
+    The capacity is always a power of two so positions wrap with a mask.
+    Free space is filled with a single readv() covering both the tail and
+    the wrapped head of the ring, and readable bytes are handed out as at
+    most two contiguous regions so they can be parsed in place.
+
+    Consumed bytes can be pinned to keep them valid after Consume(), for
+    views that outlive parsing. Pins are reference counted by position.
+    The ring does not overwrite or relocate anything from the oldest pin
+    onward, so a pin that is never released eventually stops ReadFrom().
+*/
+struct RingBuffer {
+public:
+    RingBuffer();
+    RingBuffer(const unsigned int buff_len);
+    ~RingBuffer();
+
+    RingBuffer(const struct RingBuffer&) = delete;
+    struct RingBuffer& operator=(const struct RingBuffer&) = delete;
+
+    int ReadFrom(const int fd);
+
+    const char* Peek(unsigned int& len) const;
+    void Consume(const unsigned int len);
+
+    unsigned int Length() const;
+    unsigned int Capacity() const;
+    unsigned int Available() const;
+
+    uint64_t Pin(const char* address);
+    void Unpin(const uint64_t position);
+    bool Pinned() const;
+
+    void Reserve(const unsigned int min);
+    void Clear();
+
+private:
+    struct PinEntry {
+        uint64_t position;
+        uint32_t count;
+    };
+
+    uint64_t Low() const;
+
+    char* buffer = nullptr;
+    unsigned int capacity = 0;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+
+    std::vector<struct PinEntry> pins;
+    size_t first_pin = 0;
+};
+
+#endif
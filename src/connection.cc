@@ -1,6 +1,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include "connection.h"
 
@@ -11,14 +12,36 @@ using namespace lhttp2;
 #define PREFACE "\x50\x52\x49\x20\x2a\x20\x48\x54\x54\x50\x2f\x32\x2e\x30\x0d\x0a\x0d\x0a\x53\x4d\x0d\x0a\x0d\x0a"
 #define PREFACE_LEN 24
 
+// The receive ring holds at least two frames of the maximum size and never less than this.
+#define RECV_BUFFER_SIZE_MIN 65536
+
+// Queued output is written out once it reaches this many bytes.
+#define FLUSH_THRESHOLD_DEFAULT 16384
+
+// Payloads shorter than this are copied into the send queue. Longer ones are
+// written straight from the frame before SendFrame returns.
+#define SEND_COPY_THRESHOLD 1024
+
+static unsigned int RecvBufferSize(const lhttp2::Settings& settings) {
+    unsigned int size = 2 * (FRAME_HEADER_SIZE + settings.max_frame_size());
+    if(size < RECV_BUFFER_SIZE_MIN) size = RECV_BUFFER_SIZE_MIN;
+    return size;
+}
+
 static const char preface[] = PREFACE;
 
-Connection::Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings) : fd_(fd), type_(type), settings_(settings) {
+Connection::Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings) : fd_(fd), type_(type), settings_(settings), frame_parser_(settings.max_frame_size()), recv_buff_(RecvBufferSize(settings)), flush_threshold_(FLUSH_THRESHOLD_DEFAULT) {
+    send_queue_.set_copy_threshold(SEND_COPY_THRESHOLD);
+    frame_parser_.set_frame_pool(&frame_pool_);
+    frame_parser_.set_max_header_list_size(settings.max_header_list_size());
+    decoder_table_.SetSizeLimit(settings.header_table_size());
+    encoder_table_.SetHuffmanMode(hpack::Table::HUFFMAN_ADAPTIVE);
+
     if(type_ == ENDPOINT_CLIENT) {
         SendPreface();
         SettingsFrame settings_frame;
         settings_frame.set_settings(settings_);
-        Frame::SendFrame(fd, &settings_frame, hpack_table_);
+        Frame::SendFrame(fd, &settings_frame, encoder_table_);
     }
     else if(type_ == ENDPOINT_SERVER) {
         if(RecvPreface() == false) {
@@ -26,8 +49,9 @@ Connection::Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings) :
             return;
         }
 
-        Frame* frame = Frame::RecvFrame(fd, hpack_table_);
-        if(frame->type() != Frame::TYPE_SETTINGS_FRAME) {
+        Frame* frame = RecvFrame();
+        if(frame == nullptr || frame->type() != Frame::TYPE_SETTINGS_FRAME) {
+            delete frame;
             ::close(fd_);
             return;
         }
@@ -37,7 +61,17 @@ Connection::Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings) :
 
         SettingsFrame settings_frame;
         settings_frame.set_ack_flag();
-        Frame::SendFrame(fd_, &settings_frame, hpack_table_);
+        Frame::SendFrame(fd_, &settings_frame, encoder_table_);
+    }
+}
+
+Connection::~Connection() {
+    if(send_queue_.Empty() == false) {
+        FlushQueue(false);
+    }
+
+    for(size_t i = recv_queue_head_; i < recv_queue_.size(); i++) {
+        delete recv_queue_[i];
     }
 }
 
@@ -50,30 +84,176 @@ uint32_t Connection::AllocateStream() {
     return 0;
 }
 
+// Frames are queued and written together by Flush(), which the caller is
+// expected to run once per event loop turn. The queue is also written out
+// early when it grows past the flush threshold, when its oldest frame has
+// waited longer than the flush interval, or when the frame carries a large
+// payload that is not copied into the queue.
 void Connection::SendFrame(uint32_t streamId, Frame* frame) {
-    if(streamId >= streams_.size()) {
-        return;
-    }
+    if(streamId < streams_.size()) {
+        Stream& stream = streams_[streamId];
 
-    Stream& stream = streams_[streamId];
+        switch(stream.status()) {
+            case Stream::HTTP2_STREAM_IDLE : break;
+            case Stream::HTTP2_STREAM_RESERVED : break;
+            case Stream::HTTP2_STREAM_OPEN : break;
+            case Stream::HTTP2_STREAM_HALF_CLOSED_LOCAL : break;
+            case Stream::HTTP2_STREAM_HALF_CLOSED_REMOTE : break;
+            case Stream::HTTP2_STREAM_CLOSED : break;
+            default : break;
+        }
+    }
 
-    switch(stream.status()) {
-        case Stream::HTTP2_STREAM_IDLE : break;
-        case Stream::HTTP2_STREAM_RESERVED : break;
-        case Stream::HTTP2_STREAM_OPEN : break;
-        case Stream::HTTP2_STREAM_HALF_CLOSED_LOCAL : break;
-        case Stream::HTTP2_STREAM_HALF_CLOSED_REMOTE : break;
-        case Stream::HTTP2_STREAM_CLOSED : break;
-        default : break;
+    if(send_queue_.Empty() && flush_interval_ > 0) {
+        send_queue_since_ = std::chrono::steady_clock::now();
     }
 
     frame->set_stream_id(streamId);
-    Frame::SendFrame(fd_, frame, hpack_table_);
+    send_queue_.Append(frame, encoder_table_);
+
+    if(send_queue_.Borrowed() || send_queue_.Length() >= flush_threshold_) {
+        FlushQueue(use_cork_);
+    }
+    else if(flush_interval_ > 0) {
+        std::chrono::steady_clock::duration waited = std::chrono::steady_clock::now() - send_queue_since_;
+        if(std::chrono::duration_cast<std::chrono::microseconds>(waited).count() >= flush_interval_) {
+            FlushQueue(use_cork_);
+        }
+    }
+
+    // The socket would block. Keep what is left without holding on to the frame.
+    if(send_queue_.Borrowed()) {
+        send_queue_.Detach();
+    }
+}
+
+// Sends the body as DATA frames no larger than the peer's maximum frame size.
+// Frame payloads are written straight from the chain's blocks, and only the
+// frames the socket took are kept: the unwritten tail of a frame it took in
+// part is copied into the queue, and frames it did not reach are dropped so
+// their bytes stay in the chain. Returns the number of body bytes framed,
+// which are consumed from the chain, or -1 on error. If the socket would
+// block that is less than the body, and the caller sends the rest, passing
+// end_stream again, once the socket is writable.
+//
+// A DATA frame carries one contiguous view, so no frame is longer than a block
+// of the chain, BUFFER_CHAIN_BLOCK_SIZE unless the chain was made with another
+// block size. To fill frames when the peer allows more than 16384 bytes, build
+// the body in a chain whose block size is at least the maximum frame size.
+int Connection::SendData(uint32_t streamId, BufferChain& body, bool end_stream) {
+    std::vector<BufferView> views;
+    unsigned int len = body.Split(views, peer_settings_.max_frame_size()), sent = 0;
+    uint32_t end = send_queue_.Length();
+    int written;
+    size_t i;
+
+    if(views.empty() && end_stream) {
+        views.push_back(BufferView());
+    }
+
+    for(i = 0; i < views.size(); i++) {
+        DataFrame frame;
+        frame.set_data(views[i]);
+        frame.set_stream_id(streamId);
+        if(end_stream && i + 1 == views.size()) frame.set_end_stream_flag();
+        send_queue_.Append(&frame, encoder_table_);
+    }
+
+    written = FlushQueue(use_cork_);
+
+    if(written < 0) {
+        send_queue_.Clear();
+        return -1;
+    }
+
+    // An empty body leaves a single frame with nothing borrowed, so it stays queued.
+    if(len == 0) return 0;
+
+    // Keep the frames the socket took at least a byte of. end starts where the
+    // first of them was queued and ends up past the last one that is kept.
+    for(i = 0; i < views.size() && end < (uint32_t)written; i++) {
+        end = end + FRAME_HEADER_SIZE + views[i].Length();
+        sent = sent + views[i].Length();
+    }
+
+    send_queue_.Truncate(end - written);
+
+    if(send_queue_.Borrowed()) {
+        send_queue_.Detach();
+    }
+
+    body.Consume(sent);
+
+    return sent;
+}
+
+int Connection::Flush() {
+    return FlushQueue(false);
+}
+
+uint32_t Connection::PendingBytes() const {
+    return send_queue_.Length();
 }
 
 Frame* Connection::RecvFrame() {
-    Frame* frame = Frame::RecvFrame(fd_, hpack_table_);
-    return frame;
+    if(send_queue_.Empty() == false) {
+        Flush();
+    }
+
+    while(recv_queue_head_ == recv_queue_.size()) {
+        if(RecvChunk() <= 0) {
+            return nullptr;
+        }
+    }
+
+    return PopRecvQueue();
+}
+
+bool Connection::RecvFrames(std::vector<Frame*>& frames) {
+    int len;
+
+    if(send_queue_.Empty() == false) {
+        Flush();
+    }
+
+    // Drain the socket until it would block, as edge-triggered event loops expect.
+    do {
+        len = RecvChunk();
+    } while(len > 0);
+
+    while(recv_queue_head_ < recv_queue_.size()) {
+        frames.push_back(PopRecvQueue());
+    }
+
+    return len == 0;
+}
+
+// Frames returned as handles go back to the connection's frame pool when released,
+// so the handles must be destroyed before the connection.
+FrameHandle Connection::RecvPooledFrame() {
+    return FrameHandle(RecvFrame(), &frame_pool_);
+}
+
+bool Connection::RecvPooledFrames(std::vector<FrameHandle>& frames) {
+    int len;
+
+    if(send_queue_.Empty() == false) {
+        Flush();
+    }
+
+    do {
+        len = RecvChunk();
+    } while(len > 0);
+
+    while(recv_queue_head_ < recv_queue_.size()) {
+        frames.push_back(FrameHandle(PopRecvQueue(), &frame_pool_));
+    }
+
+    return len == 0;
+}
+
+void Connection::ReleaseFrame(Frame* frame) {
+    frame_pool_.Release(frame);
 }
 
 uint32_t Connection::LastClientStreamId() {
@@ -98,17 +278,241 @@ lhttp2::Settings& Connection::Settings() {
 
 void Connection::SetSettings(lhttp2::Settings settings) {
     settings_ = settings;
-    hpack_table_.UpdateSize(settings_.header_table_size());
+    decoder_table_.SetSizeLimit(settings_.header_table_size());
+    frame_parser_.set_max_frame_size(settings_.max_frame_size());
+    frame_parser_.set_max_header_list_size(settings_.max_header_list_size());
+}
+
+// The settings the peer has sent so far, defaults for those it has not.
+const lhttp2::Settings& Connection::PeerSettings() const {
+    return peer_settings_;
 }
 
+// Huffman codes a header string only when that makes it shorter.
 void Connection::UseHuffman(bool use) {
-    use_huffman_ = use;
+    encoder_table_.SetHuffmanMode(use ? hpack::Table::HUFFMAN_ADAPTIVE : hpack::Table::HUFFMAN_NEVER);
+}
+
+void Connection::SetHuffmanMode(hpack::Table::HUFFMAN_MODE mode) {
+    encoder_table_.SetHuffmanMode(mode);
+}
+
+// Header lists sent again while the encoder's table is unchanged reuse their
+// encoded block, e.g. the same response headers on every stream.
+void Connection::UseHeaderBlockCache(bool use) {
+    encoder_table_.UseBlockCache(use);
+}
+
+// The policy decides which sent fields enter the encoder's table. It is not
+// owned by the connection and must outlive it, or be unset first.
+void Connection::SetIndexingPolicy(hpack::IndexingPolicy* policy) {
+    encoder_table_.SetIndexingPolicy(policy);
+}
+
+// Warm starts the encoder's table with fields every connection sends, e.g.
+// one dictionary shared by all of a proxy's backend connections. It is not
+// owned by the connection and must outlive it.
+void Connection::SetHeaderDictionary(const hpack::Dictionary* dictionary) {
+    encoder_table_.SetDictionary(dictionary);
+}
+
+// A received header block with a name that is not lower case visible ASCII
+// fails to decode, and so ends the connection with a COMPRESSION_ERROR.
+void Connection::UseHeaderNameValidation(bool use) {
+    decoder_table_.UseNameValidation(use);
+}
+
+void Connection::UseHpackStats(bool use) {
+    encoder_table_.UseStats(use);
+    decoder_table_.UseStats(use);
+}
+
+HpackStats Connection::GetHpackStats() const {
+    HpackStats stats;
+    const hpack::BlockCache* block_cache = encoder_table_.GetBlockCache();
+
+    stats.encoder = encoder_table_.Stats();
+    stats.decoder = decoder_table_.Stats();
+    if(block_cache != nullptr) {
+        stats.block_cache_hits = block_cache->Hits();
+        stats.block_cache_misses = block_cache->Misses();
+    }
+    return stats;
+}
+
+// Received DATA frames reference the receive buffer instead of copying their payload.
+// Every such frame must be released before the connection is destroyed, and frames
+// that are held on to keep the buffer pinned, which eventually stalls receiving.
+//
+// Once the pinned bytes fill the whole buffer, receiving stops without reading the
+// socket and RecvPinned() is set. RecvFrame() then returns nullptr and RecvFrames()
+// true as if the socket would block, but the socket's readiness has not been used
+// up, so an edge-triggered loop gets no further event for it. The caller must
+// release frames and receive again rather than wait for the socket.
+void Connection::UseZeroCopyData(bool use) {
+    frame_parser_.set_recv_buffer(use ? &recv_buff_ : nullptr);
+}
+
+// Whether the last receive stopped because released frames are needed to read on.
+bool Connection::RecvPinned() const {
+    return recv_pinned_;
+}
+
+// With cork mode, flushes made while frames are still being produced pass
+// MSG_MORE so the kernel holds back a partial segment until Flush().
+void Connection::UseCork(bool use) {
+    use_cork_ = use;
+}
+
+void Connection::SetFlushThreshold(uint32_t bytes) {
+    flush_threshold_ = bytes;
+}
+
+// The interval is checked when a frame is sent, and receiving flushes the
+// queue anyway. There is no timer, so frames queued on a connection that then
+// goes quiet are only written by the Flush() the event loop runs every turn.
+void Connection::SetFlushInterval(uint32_t usec) {
+    flush_interval_ = usec;
+    send_queue_since_ = std::chrono::steady_clock::now();
+}
+
+int Connection::FlushQueue(bool more) {
+    return send_queue_.Flush(fd_, more ? MSG_MORE : 0);
 }
 
 void Connection::SendPreface() {
     ::send(fd_, preface, PREFACE_LEN, 0);
 }
 
+// Returns the number of bytes read, 0 if the socket would block or the ring
+// is full of pinned bytes, which RecvPinned() tells apart, or -1 if the peer
+// closed the connection or sent a malformed frame.
+int Connection::RecvChunk() {
+    int len;
+    bool parsed;
+
+    // Grow the ring once settings ask for it and nothing is pinned in it any more.
+    recv_buff_.Reserve(RecvBufferSize(settings_));
+
+    // Bytes still referenced by received frames fill the whole ring.
+    recv_pinned_ = (recv_buff_.Available() == 0);
+    if(recv_pinned_ == true) return 0;
+
+    do {
+        len = recv_buff_.ReadFrom(fd_);
+    } while(len < 0 && errno == EINTR);
+
+    if(len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    if(len <= 0) return -1;
+
+    parsed = ParseRecvBuffer(recv_queue_);
+
+    if(parsed == false) return -1;
+    return len;
+}
+
+Frame* Connection::PopRecvQueue() {
+    Frame* frame = recv_queue_[recv_queue_head_++];
+
+    // Rewind a drained queue so it keeps its storage.
+    if(recv_queue_head_ == recv_queue_.size()) {
+        recv_queue_.clear();
+        recv_queue_head_ = 0;
+    }
+
+    return frame;
+}
+
+bool Connection::ParseRecvBuffer(std::vector<Frame*>& frames) {
+    unsigned int len;
+    const char* data;
+    int parsed;
+    bool wrapped;
+    size_t first = frames.size();
+
+    while(recv_buff_.Length() > 0) {
+        data = recv_buff_.Peek(len);
+        wrapped = (len < recv_buff_.Length());
+
+        // Frames are parsed in place. Only a frame that straddles the end
+        // of the ring is copied into the parser.
+        parsed = frame_parser_.Parse(data, len, frames, decoder_table_, wrapped);
+        if(parsed < 0) return false;
+
+        recv_buff_.Consume(parsed);
+        if((unsigned int)parsed < len) break;
+    }
+
+    for(size_t i = first; i < frames.size(); i++) {
+        Frame* frame = frames[i];
+        bool oversized = false;
+
+        if(frame->type() == Frame::TYPE_SETTINGS_FRAME) ApplyPeerSettings((SettingsFrame*)frame);
+        else if(frame->type() == Frame::TYPE_HEADERS_FRAME) {
+            header_block_promised_stream_ = 0;
+            oversized = ((HeadersFrame*)frame)->header_list_oversized();
+        }
+        else if(frame->type() == Frame::TYPE_PUSH_PROMISE_FRAME) {
+            header_block_promised_stream_ = ((PushPromisFrame*)frame)->promised_stream_id();
+            oversized = ((PushPromisFrame*)frame)->header_list_oversized();
+        }
+        else if(frame->type() == Frame::TYPE_CONTINUATION_FRAME) oversized = ((ContinuationFrame*)frame)->header_list_oversized();
+
+        if(oversized == true && frame->has_flags(Frame::FLAG_END_HEADERS)) {
+            RefuseHeaderBlock(frame->stream_id(), header_block_promised_stream_);
+        }
+    }
+
+    return true;
+}
+
+// A SETTINGS frame only changes the parameters it carries, the others keep
+// the value the peer set before. The peer's SETTINGS_HEADER_TABLE_SIZE bounds
+// our encoder's table, which tells the peer's decoder of the new size in the
+// next header block.
+void Connection::ApplyPeerSettings(SettingsFrame* frame) {
+    const lhttp2::Settings& settings = frame->settings();
+
+    if(frame->has_ack_flag() == true) return;
+
+    if(frame->has_parameter(SettingsFrame::SETTINGS_HEADER_TABLE_SIZE) == true) {
+        peer_settings_.set_header_table_size(settings.header_table_size());
+        encoder_table_.SetMaxSize(settings.header_table_size());
+    }
+    if(frame->has_parameter(SettingsFrame::SETTINGS_ENABLE_PUSH) == true) peer_settings_.set_enable_push(settings.enable_push());
+    if(frame->has_parameter(SettingsFrame::SETTINGS_MAX_CONCURRENT_STREAMS) == true) peer_settings_.set_max_concurrent_stream(settings.max_concurrent_stream());
+    if(frame->has_parameter(SettingsFrame::SETTINGS_INITIAL_WINDOW_SIZE) == true) peer_settings_.set_initial_window_size(settings.initial_window_size());
+    if(frame->has_parameter(SettingsFrame::SETTINGS_MAX_FRAME_SIZE) == true) peer_settings_.set_max_frame_size(settings.max_frame_size());
+    if(frame->has_parameter(SettingsFrame::SETTINGS_MAX_HEADER_LIST_SIZE) == true) peer_settings_.set_max_header_list_size(settings.max_header_list_size());
+}
+
+// A header block larger than our SETTINGS_MAX_HEADER_LIST_SIZE was decoded
+// with its fields dropped, so only its stream is refused: a server answers the
+// request with 431, and a client resets the response's stream, or the one a
+// PUSH_PROMISE reserved. The block's frames are still returned, flagged
+// header_list_oversized(), for the caller to discard.
+void Connection::RefuseHeaderBlock(uint32_t stream_id, uint32_t promised_stream_id) {
+    if(promised_stream_id != 0) {
+        RSTStreamFrame rst_stream(HTTP2_ERROR_REFUSED_STREAM);
+        SendFrame(promised_stream_id, &rst_stream);
+    }
+    else if(type_ == ENDPOINT_SERVER) {
+        std::vector<hpack::HeaderFieldRepresentation> header_list(1);
+        header_list[0].Field().SetName(std::string(":status"));
+        header_list[0].Field().SetValue(std::string("431"));
+        header_list[0].Type() = hpack::HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING;
+
+        HeadersFrame headers(header_list, encoder_table_, (uint8_t)0);
+        headers.set_end_headers_flag();
+        headers.set_end_stream_flag();
+        SendFrame(stream_id, &headers);
+    }
+    else {
+        RSTStreamFrame rst_stream(HTTP2_ERROR_CANCEL);
+        SendFrame(stream_id, &rst_stream);
+    }
+}
+
 bool Connection::RecvPreface() {
     char buffer[PREFACE_LEN];
     int read_len;
@@ -2,14 +2,36 @@
 #define _LHTTP2_CONNECTION_H
 
 #include <vector>
+#include <chrono>
 #include <stdint.h>
 
 #include "stream.h"
 #include "frame.h"
+#include "frame_parser.h"
+#include "frame_pool.h"
+#include "frame_writer.h"
+#include "buffer/ring_buffer.h"
+#include "buffer/buffer_chain.h"
 #include "settings.h"
 #include "hpack/hpack.h"
+#include "hpack/indexing_policy.h"
 
 namespace lhttp2 {
+    /*
+        ### HPACK statistics ###
+        Snapshot of both header tables of a connection, taken by
+        Connection::GetHpackStats(). The counters are only kept after
+        UseHpackStats(true); comparing encoded to raw bytes and the eviction
+        counts for a few table sizes tells what SETTINGS_HEADER_TABLE_SIZE
+        is worth for the traffic.
+    */
+    struct HpackStats {
+        hpack::TableStats encoder;
+        hpack::TableStats decoder;
+        uint64_t block_cache_hits = 0;
+        uint64_t block_cache_misses = 0;
+    };
+
     class Connection {
     public:
         typedef enum _ENDPOINT_TYPE {
@@ -18,11 +40,21 @@ namespace lhttp2 {
         } ENDPOINT_TYPE;
 
         Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings = lhttp2::Settings());
+        ~Connection();
 
         uint32_t AllocateStream();
 
         void SendFrame(uint32_t streamId, Frame* frame);
+        int SendData(uint32_t streamId, BufferChain& body, bool end_stream = false);
+        int Flush();
+        uint32_t PendingBytes() const;
+
         Frame* RecvFrame();
+        bool RecvFrames(std::vector<Frame*>& frames);
+
+        FrameHandle RecvPooledFrame();
+        bool RecvPooledFrames(std::vector<FrameHandle>& frames);
+        void ReleaseFrame(Frame* frame);
 
         uint32_t LastClientStreamId();
         uint32_t LastServerStreamId();
@@ -30,20 +62,55 @@ namespace lhttp2 {
 
         lhttp2::Settings& Settings();
         void SetSettings(lhttp2::Settings settings);
+        const lhttp2::Settings& PeerSettings() const;
 
         void UseHuffman(bool use);
+        void SetHuffmanMode(hpack::Table::HUFFMAN_MODE mode);
+        void UseHeaderBlockCache(bool use);
+        void SetIndexingPolicy(hpack::IndexingPolicy* policy);
+        void SetHeaderDictionary(const hpack::Dictionary* dictionary);
+        void UseHeaderNameValidation(bool use);
+        void UseHpackStats(bool use);
+        HpackStats GetHpackStats() const;
+
+        void UseZeroCopyData(bool use);
+        bool RecvPinned() const;
+        void UseCork(bool use);
+        void SetFlushThreshold(uint32_t bytes);
+        void SetFlushInterval(uint32_t usec);
 
     private:
         void SendPreface();
         bool RecvPreface();
+        int FlushQueue(bool more);
+        int RecvChunk();
+        Frame* PopRecvQueue();
+        bool ParseRecvBuffer(std::vector<Frame*>& frames);
+        void ApplyPeerSettings(SettingsFrame* frame);
+        void RefuseHeaderBlock(uint32_t stream_id, uint32_t promised_stream_id);
 
         int fd_;
         ENDPOINT_TYPE type_;
         std::vector<Stream> streams_;
         uint32_t window_size_ = 65535;
         lhttp2::Settings settings_;
-        hpack::Table hpack_table_;
-        bool use_huffman_ = true;
+        lhttp2::Settings peer_settings_;
+        hpack::Table encoder_table_;
+        hpack::Table decoder_table_;
+
+        FramePool frame_pool_;
+        FrameParser frame_parser_;
+        std::vector<Frame*> recv_queue_;
+        size_t recv_queue_head_ = 0;
+        RingBuffer recv_buff_;
+        bool recv_pinned_ = false;
+        uint32_t header_block_promised_stream_ = 0;
+
+        FrameWriter send_queue_;
+        bool use_cork_ = false;
+        uint32_t flush_threshold_;
+        uint32_t flush_interval_ = 0;
+        std::chrono::steady_clock::time_point send_queue_since_;
     };
 
     class Server : public Connection {
@@ -1,9 +1,11 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
-#include <signal.h>
+
+#include <utility>
 
 #include "frame.h"
+#include "frame_writer.h"
 
 using namespace lhttp2;
 
@@ -49,98 +51,64 @@ void Frame::set_stream_id(uint32_t streamId) {
     stream_id_ = streamId;
 }
 
+static bool ReadFull(const int fd, char* buff, const uint32_t len) {
+    uint32_t idx = 0;
+    while(idx < len) {
+        int read_len = ::read(fd, buff + idx, len - idx);
+        if(read_len <= 0) return false;
+        idx = idx + read_len;
+    }
+    return true;
+}
+
 Frame* Frame::RecvFrame(const int fd, hpack::Table& hpack_table, bool debug) {
     if(fd < 0) {
         return nullptr;
     }
 
-    Frame *frame;
-    char header_buff[9];
-    uint8_t flags;
-    uint32_t length, stream_id;
-    bool reserved;
-    FRAME_TYPE type;
+    char header_buff[FRAME_HEADER_SIZE];
+    uint32_t length;
 
-    if(::read(fd, header_buff, 9) != 9) {
+    if(ReadFull(fd, header_buff, FRAME_HEADER_SIZE) == false) {
         return nullptr;
     }
 
-    length = (uint32_t)header_buff[0] << 16 | \
-             (uint32_t)header_buff[1] << 8 | \
-             (uint32_t)header_buff[2];
-
-    type = (FRAME_TYPE)header_buff[3];
-    flags = (uint8_t)header_buff[4];
-    reserved = ((header_buff[5] & 0x80) == 0x80);
-
-    stream_id = (uint32_t)(header_buff[5] & 0x7F) << 24 | \
-                (uint32_t)header_buff[6] << 16 | \
-                (uint32_t)header_buff[7] << 8 | \
-                (uint32_t)header_buff[8];
-
-    if(type > 0x09) {
-        return nullptr;
-    }
+    length = (uint32_t)(uint8_t)header_buff[0] << 16 | \
+             (uint32_t)(uint8_t)header_buff[1] << 8 | \
+             (uint32_t)(uint8_t)header_buff[2];
 
     char* payload_buff = new char[length];
 
-    if(::read(fd, payload_buff, length) != length) {
+    if(ReadFull(fd, payload_buff, length) == false) {
         delete[] payload_buff;
         return nullptr;
     }
 
-    if(type == TYPE_DATA_FRAME)
-        frame = new DataFrame();
-    else if(type == TYPE_HEADERS_FRAME)
-        frame = new HeadersFrame();
-    else if(type == TYPE_PRIORITY_FRAME)
-        frame = new PriorityFrame();
-    else if(type == TYPE_RST_STREAM_FRAME)
-        frame = new RSTStreamFrame();
-    else if(type == TYPE_SETTINGS_FRAME)
-        frame = new SettingsFrame();
-    else if(type == TYPE_PUSH_PROMISE_FRAME)
-        frame = new PushPromisFrame();
-    else if(type == TYPE_PING_FRAME)
-        frame = new PingFrame();
-    else if(type == TYPE_GOAWAY_FRAME)
-        frame = new GoawayFrame();
-    else if(type == TYPE_WINDOW_UPDATE_FRAME)
-        frame = new WindowUpdateFrame();
-    else if(type == TYPE_CONTINUATION_FRAME)
-        frame = new ContinuationFrame();
-    else {
-        delete[] payload_buff;
-        return nullptr;
-    }
-
-    frame->length_ = length;
-    frame->type_ = type;
-    frame->flags_ = flags;
-    frame->reserved_ = reserved;
-    frame->stream_id_ = stream_id;
-
-    if(debug) {
-        Buffer::PrintBuffer(header_buff, 9);
-        Buffer::PrintBuffer(payload_buff, length);
-    }
-
-    frame->DecodeFramePayload((const char *)payload_buff, frame->length_, hpack_table);
+    Frame* frame = DecodeFrame(header_buff, BufferView(payload_buff, length), hpack_table, debug);
 
     delete[] payload_buff;
 
     return frame;
 }
 
+// Writes the whole frame, going on after short writes. Returns the number of
+// bytes written, or -1 on error. A non-blocking fd that would block leaves the
+// frame cut short for the peer, so that is an error too, with errno EAGAIN;
+// non-blocking callers queue frames through a FrameWriter or a Connection.
 int Frame::SendFrame(const int fd, Frame* frame, hpack::Table& hpack_table, bool debug) {
-    Buffer *stream = frame->EncodeFrame(hpack_table);
-    if(debug == true) stream->Print();
+    FrameWriter writer;
+    int written, total = 0;
 
-    signal(SIGPIPE, SIG_IGN);
-    int len = ::send(fd, stream->Address(), stream->Length(), 0);
+    writer.Append(frame, hpack_table);
+    if(debug == true) writer.Print();
+
+    while(writer.Empty() == false) {
+        written = writer.Flush(fd);
+        if(written <= 0) return -1;
+        total = total + written;
+    }
 
-    delete stream;
-    return len;
+    return total;
 }
 
 const std::string Frame::GetFrameTypeName(FRAME_TYPE type) {
@@ -160,19 +128,92 @@ const std::string Frame::GetFrameTypeName(FRAME_TYPE type) {
     return "UNKNOWN";
 }
 
-Buffer* Frame::EncodeFrame(hpack::Table& hpack_table) {
-    Buffer* payloadBuffer = EncodeFramePayload(hpack_table);
-    Buffer* headerBuffer = new Buffer(9 + payloadBuffer->Length());
+Frame* Frame::CreateFrame(FRAME_TYPE type) {
+    switch(type) {
+        case TYPE_DATA_FRAME: return new DataFrame();
+        case TYPE_HEADERS_FRAME: return new HeadersFrame();
+        case TYPE_PRIORITY_FRAME: return new PriorityFrame();
+        case TYPE_RST_STREAM_FRAME: return new RSTStreamFrame();
+        case TYPE_SETTINGS_FRAME: return new SettingsFrame();
+        case TYPE_PUSH_PROMISE_FRAME: return new PushPromisFrame();
+        case TYPE_PING_FRAME: return new PingFrame();
+        case TYPE_GOAWAY_FRAME: return new GoawayFrame();
+        case TYPE_WINDOW_UPDATE_FRAME: return new WindowUpdateFrame();
+        case TYPE_CONTINUATION_FRAME: return new ContinuationFrame();
+        default: break;
+    }
+    return nullptr;
+}
+
+Frame* Frame::DecodeFrame(const char* header_buff, const BufferView& payload, hpack::Table& hpack_table, bool debug) {
+    Frame* frame = CreateFrame((FRAME_TYPE)(uint8_t)header_buff[3]);
 
-    headerBuffer->SetValue(payloadBuffer->Length(), 3, 0);
-    headerBuffer->SetValue(type_, 1, 3);
-    headerBuffer->SetValue(flags_, 1, 4);
-    headerBuffer->SetValue((reserved_ << 7) | (stream_id_ & 0x7FFFFFFF), 4, 5);
+    if(frame == nullptr) {
+        return nullptr;
+    }
 
-    headerBuffer->Append(*payloadBuffer);
-    delete payloadBuffer;
+    if(DecodeFrame(frame, header_buff, payload, hpack_table, debug) == false) {
+        delete frame;
+        return nullptr;
+    }
 
-    return headerBuffer;
+    return frame;
+}
+
+// Decodes into an existing frame of the matching type, e.g. one recycled by a FramePool.
+// Every field is overwritten, so the frame does not need to be cleared first.
+bool Frame::DecodeFrame(Frame* frame, const char* header_buff, const BufferView& payload, hpack::Table& hpack_table, bool debug) {
+    const uint8_t* header = (const uint8_t*)header_buff;
+
+    if(frame->type_ != (FRAME_TYPE)header[3]) {
+        return false;
+    }
+
+    frame->length_ = (uint32_t)header[0] << 16 | \
+                     (uint32_t)header[1] << 8 | \
+                     (uint32_t)header[2];
+    frame->flags_ = header[4];
+    frame->reserved_ = ((header[5] & 0x80) == 0x80);
+    frame->stream_id_ = (uint32_t)(header[5] & 0x7F) << 24 | \
+                        (uint32_t)header[6] << 16 | \
+                        (uint32_t)header[7] << 8 | \
+                        (uint32_t)header[8];
+
+    if(payload.Length() != frame->length_) {
+        return false;
+    }
+
+    if(debug) {
+        Buffer::PrintBuffer(header_buff, FRAME_HEADER_SIZE);
+        payload.Print();
+    }
+
+    return frame->DecodeFramePayload(payload, hpack_table);
+}
+
+void Frame::EncodeFrameHeader(char* header_buff, const uint32_t length) const {
+    uint32_t stream_id = ((uint32_t)reserved_ << 31) | (stream_id_ & 0x7FFFFFFF);
+
+    header_buff[0] = (char)(length >> 16);
+    header_buff[1] = (char)(length >> 8);
+    header_buff[2] = (char)length;
+    header_buff[3] = (char)type_;
+    header_buff[4] = (char)flags_;
+    header_buff[5] = (char)(stream_id >> 24);
+    header_buff[6] = (char)(stream_id >> 16);
+    header_buff[7] = (char)(stream_id >> 8);
+    header_buff[8] = (char)stream_id;
+}
+
+void Frame::EncodeFrameSegments(hpack::Table& hpack_table, FrameWriter& writer) {
+    char header_buff[FRAME_HEADER_SIZE];
+    Buffer* payload = EncodeFramePayload(hpack_table);
+
+    EncodeFrameHeader(header_buff, payload->Length());
+    writer.AppendCopy(header_buff, FRAME_HEADER_SIZE);
+    writer.AppendCopy(payload->Address(), payload->Length());
+
+    delete payload;
 }
 
 /*
@@ -182,19 +223,18 @@ DataFrame::DataFrame() {
     type_ = TYPE_DATA_FRAME;
 }
 
-DataFrame::DataFrame(Buffer data, uint8_t pad_length) {
-    DataFrame();
-
+DataFrame::DataFrame(Buffer data, uint8_t pad_length) : DataFrame() {
     pad_length_ = pad_length;
     if(pad_length_ > 0) set_flags(FLAG_PADDED);
     else clear_flags(FLAG_PADDED);
 
-    data_ = data;
+    data_ = std::move(data);
 
     UpdateLength();
 }
 
 DataFrame::~DataFrame() {
+    ReleaseData();
 }
 
 const uint8_t DataFrame::pad_length() const {
@@ -205,15 +245,57 @@ const Buffer& DataFrame::data() const {
     return data_;
 }
 
+const BufferView DataFrame::data_view() const {
+    if(is_data_view()) return view_;
+    return BufferView(data_);
+}
+
+const char* DataFrame::data_address() const {
+    return data_view().Address();
+}
+
+const uint32_t DataFrame::data_length() const {
+    return data_view().Length();
+}
+
+bool DataFrame::is_data_view() const {
+    return view_.Empty() == false;
+}
+
 void DataFrame::set_pad_length(uint8_t pad_length) {
     pad_length_ = pad_length;
 }
 
 void DataFrame::set_data(Buffer& data) {
+    ReleaseData();
     data_ = data;
     UpdateLength();
 }
 
+void DataFrame::set_data(Buffer&& data) {
+    ReleaseData();
+    data_ = std::move(data);
+    UpdateLength();
+}
+
+// The caller keeps the memory behind data alive until the frame is sent
+// or its data is replaced.
+void DataFrame::set_data(const BufferView& data) {
+    ReleaseData();
+    data_.Clear();
+    view_ = data;
+    UpdateLength();
+}
+
+void DataFrame::ReleaseData() {
+    if(is_data_view() == false) return;
+
+    if(view_buffer_ != nullptr) view_buffer_->Unpin(view_position_);
+    view_buffer_ = nullptr;
+    view_ = BufferView();
+    UpdateLength();
+}
+
 bool DataFrame::has_end_stream_flag() const {
     return has_flags(FLAG_END_STREAM);
 }
@@ -240,36 +322,70 @@ void DataFrame::clear_padded_flag() {
     UpdateLength();
 }
 
+void DataFrame::EncodeFrameSegments(hpack::Table& hpack_table, FrameWriter& writer) {
+    char header_buff[FRAME_HEADER_SIZE + 1];
+
+    UpdateLength();
+    EncodeFrameHeader(header_buff, length_);
+
+    if(has_padded_flag()) {
+        header_buff[FRAME_HEADER_SIZE] = (char)pad_length_;
+        writer.AppendCopy(header_buff, FRAME_HEADER_SIZE + 1);
+        writer.AppendReference(data_address(), data_length());
+        writer.AppendPadding(pad_length_);
+    }
+    else {
+        writer.AppendCopy(header_buff, FRAME_HEADER_SIZE);
+        writer.AppendReference(data_address(), data_length());
+    }
+}
+
 Buffer* DataFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     Buffer *stream = new Buffer(length_);
 
     if(has_padded_flag()) {
         stream->Set(pad_length_, 0);
-        stream->Append(data_);
+        stream->Append(data_address(), data_length());
     }
     else {
-        stream->Append(data_);
+        stream->Append(data_address(), data_length());
     }
 
     return stream;
 }
 
-bool DataFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    int idx = 0;
+bool DataFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    int idx = 0, len = payload.Length();
 
+    pad_length_ = 0;
     if(has_padded_flag()) {
-        pad_length_ = buff[idx];
+        if(len < 1) return false;
+        pad_length_ = payload.GetValue(1, idx);
         idx = idx + 1;
     }
 
-    data_ = Buffer(buff + idx, len - pad_length_ - idx);
+    if(pad_length_ > len - idx) return false;
+
+    ReleaseData();
+
+    BufferView data = payload.Slice(idx, len - pad_length_ - idx);
+
+    if(view_source_ != nullptr && data.Empty() == false) {
+        view_buffer_ = view_source_;
+        view_position_ = view_buffer_->Pin(data.Address());
+        view_ = data;
+        data_.Clear();
+    }
+    else {
+        data_.Copy(data);
+    }
     UpdateLength();
 
     return true;
 }
 
 void DataFrame::UpdateLength() {
-    length_ = data_.Length();
+    length_ = data_length();
 
     if(has_padded_flag())
         length_ = length_ + pad_length_ + 1;
@@ -282,22 +398,17 @@ HeadersFrame::HeadersFrame() {
     type_ = TYPE_HEADERS_FRAME;
 }
 
-HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table, uint8_t pad_length) {
-    HeadersFrame();
-
+HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table, uint8_t pad_length) : HeadersFrame() {
     pad_length_ = pad_length;
     if(pad_length_ > 0) set_flags(FLAG_PADDED);
     else clear_flags(FLAG_PADDED);
 
     clear_flags(FLAG_PRIORITY);
 
-    header_list_ = header_list;
-    update_header_block_fragment(hpack_table);
+    set_header_list(std::move(header_list), hpack_table);
 }
 
-HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table, bool exclusive, uint32_t stream_dependency, uint8_t weight, uint8_t pad_length) {
-    HeadersFrame();
-
+HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table, bool exclusive, uint32_t stream_dependency, uint8_t weight, uint8_t pad_length) : HeadersFrame() {
     pad_length_ = pad_length;
     if(pad_length_ > 0) set_flags(FLAG_PADDED);
     else clear_flags(FLAG_PADDED);
@@ -307,8 +418,7 @@ HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_
     stream_dependency_ = stream_dependency;
     weight_ = weight;
 
-    header_list_ = header_list;
-    update_header_block_fragment(hpack_table);
+    set_header_list(std::move(header_list), hpack_table);
 }
 
 HeadersFrame::~HeadersFrame() {
@@ -330,7 +440,10 @@ const uint8_t HeadersFrame::weight() const {
     return weight_;
 }
 
-const std::vector<hpack::HeaderFieldRepresentation>& HeadersFrame::header_list() const {
+// The fields of a received frame, or those the frame was given to send.
+// Views into a received frame's list are valid until it is decoded again or
+// destroyed.
+const hpack::HeaderList& HeadersFrame::header_list() const {
     return header_list_;
 }
 
@@ -338,6 +451,13 @@ const Buffer& HeadersFrame::header_block_fragment() const {
     return header_;
 }
 
+// Whether the block this frame belongs to exceeded the maximum header list
+// size by the end of this frame. Its fields are then dropped, and those of
+// the block's earlier frames must be discarded too.
+const bool HeadersFrame::header_list_oversized() const {
+    return header_list_oversized_;
+}
+
 void HeadersFrame::set_pad_length(uint8_t pad_length) {
     pad_length_ = pad_length;
 }
@@ -354,13 +474,29 @@ void HeadersFrame::set_weight(uint8_t weight) {
     weight_ = weight;
 }
 
+// The list given to send is kept as it is for encoding, and header_list()
+// refers to its strings.
 void HeadersFrame::set_header_list(std::vector<hpack::HeaderFieldRepresentation> headerList, hpack::Table& hpack_table) {
-    header_list_ = headerList;
+    header_fields_ = std::move(headerList);
+
+    header_list_.Clear();
+    for(size_t i = 0; i < header_fields_.size(); i++) {
+        const hpack::HeaderField& field = header_fields_[i].Field();
+        header_list_.AppendReference(header_fields_[i].Type(), BufferView(field.Name().data(), field.Name().length()), BufferView(field.Value().data(), field.Value().length()));
+    }
+
     update_header_block_fragment(hpack_table);
 }
 
+// Encodes the header list without touching the table, e.g. to learn the frame length.
 void HeadersFrame::update_header_block_fragment(hpack::Table& hpack_table) {
-    hpack_table.Encode(header_, header_list_, false);
+    EncodeHeaderBlock(hpack_table, false);
+}
+
+// Encoding for transmission adds indexed fields to the encoder's table,
+// mirroring what the peer's decoder does with the block.
+void HeadersFrame::EncodeHeaderBlock(hpack::Table& hpack_table, bool update) {
+    hpack_table.Encode(header_, header_fields_, update);
     UpdateLength();
 }
 
@@ -416,8 +552,38 @@ void HeadersFrame::clear_priority_flag() {
     UpdateLength();
 }
 
+void HeadersFrame::EncodeFrameSegments(hpack::Table& hpack_table, FrameWriter& writer) {
+    char header_buff[FRAME_HEADER_SIZE + 6];
+    int idx = FRAME_HEADER_SIZE;
+    uint32_t stream_dependency = ((uint32_t)exclusive_ << 31) | (stream_dependency_ & 0x7FFFFFFF);
+
+    EncodeHeaderBlock(hpack_table, true);
+    EncodeFrameHeader(header_buff, length_);
+
+    if(has_padded_flag()) {
+        header_buff[idx] = (char)pad_length_;
+        idx = idx + 1;
+    }
+
+    if(has_priority_flag()) {
+        header_buff[idx] = (char)(stream_dependency >> 24);
+        header_buff[idx + 1] = (char)(stream_dependency >> 16);
+        header_buff[idx + 2] = (char)(stream_dependency >> 8);
+        header_buff[idx + 3] = (char)stream_dependency;
+        header_buff[idx + 4] = (char)weight_;
+        idx = idx + 5;
+    }
+
+    writer.AppendCopy(header_buff, idx);
+    writer.AppendReference(header_.Address(), header_.Length());
+
+    if(has_padded_flag()) {
+        writer.AppendPadding(pad_length_);
+    }
+}
+
 Buffer* HeadersFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    update_header_block_fragment(hpack_table);
+    EncodeHeaderBlock(hpack_table, true);
     int idx = 0;
     Buffer *stream = new Buffer(length_);
 
@@ -437,28 +603,44 @@ Buffer* HeadersFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     return stream;
 }
 
-bool HeadersFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    int idx = 0;
+bool HeadersFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    int idx = 0, len = payload.Length();
+
+    pad_length_ = 0;
+    exclusive_ = false;
+    stream_dependency_ = 0;
+    weight_ = 0;
+    header_fields_.clear();
+    header_list_.Clear();
+    header_list_oversized_ = false;
 
     if(has_padded_flag()) {
-        pad_length_ = buff[idx];
+        if(len < 1) return false;
+        pad_length_ = payload.GetValue(1, idx);
         idx = idx + 1;
     }
 
     if(has_priority_flag()) {
-        exclusive_ = ((buff[idx] & 0x80) == 0x80);
-        stream_dependency_ = (uint32_t)(buff[idx] & 0x7F) << 24 | \
-                            (uint32_t)buff[idx + 1] << 16 | \
-                            (uint32_t)buff[idx + 2] << 8 | \
-                            (uint32_t)buff[idx + 3];
-        weight_ = buff[idx + 4];
+        if(len - idx < 5) return false;
+        exclusive_ = ((payload.Get(idx) & 0x80) == 0x80);
+        stream_dependency_ = payload.GetValue(4, idx) & 0x7FFFFFFF;
+        weight_ = payload.GetValue(1, idx + 4);
         idx = idx + 5;
     }
 
-    header_ = Buffer(buff + idx, len - pad_length_ - idx);
-    if(hpack_table.Decode(header_list_, header_) == false) {
+    if(pad_length_ > len - idx) return false;
+
+    BufferView header_block = payload.Slice(idx, len - pad_length_ - idx);
+    if(block_decoder_ != nullptr) {
+        if(block_decoder_->Decode(hpack_table, header_block, header_list_) == false) return false;
+        if(has_end_headers_flag() && block_decoder_->End() == false) return false;
+        header_list_oversized_ = block_decoder_->Oversized();
+        if(header_list_oversized_ == true) header_list_.Clear();
+    }
+    else if(hpack_table.Decode(header_list_, header_block) == false) {
         return false;
     }
+    header_.Copy(header_block);
 
     UpdateLength();
 
@@ -483,8 +665,7 @@ PriorityFrame::PriorityFrame() {
     length_ = 5;
 }
 
-PriorityFrame::PriorityFrame(bool exclusive, uint32_t stream_dependency, uint8_t weight) {
-    PriorityFrame();
+PriorityFrame::PriorityFrame(bool exclusive, uint32_t stream_dependency, uint8_t weight) : PriorityFrame() {
     exclusive_ = exclusive;
     stream_dependency_ = stream_dependency;
     weight_ = weight;
@@ -526,15 +707,12 @@ Buffer* PriorityFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     return stream;
 }
 
-bool PriorityFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    if(len != 5) return false;
+bool PriorityFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    if(payload.Length() != 5) return false;
 
-    exclusive_ = ((buff[0] & 0x80) == 0x80);
-    stream_dependency_ = (uint32_t)(buff[0] & 0x7F) << 24 | \
-                        (uint32_t)buff[1] << 16 | \
-                        (uint32_t)buff[2] << 8 | \
-                        (uint32_t)buff[3];
-    weight_ = buff[4];
+    exclusive_ = ((payload.Get(0) & 0x80) == 0x80);
+    stream_dependency_ = payload.GetValue(4, 0) & 0x7FFFFFFF;
+    weight_ = payload.GetValue(1, 4);
 
     UpdateLength();
 
@@ -553,8 +731,7 @@ RSTStreamFrame::RSTStreamFrame() {
     length_ = 4;
 }
 
-RSTStreamFrame::RSTStreamFrame(uint32_t error_code) {
-    RSTStreamFrame();
+RSTStreamFrame::RSTStreamFrame(uint32_t error_code) : RSTStreamFrame() {
     error_code_ = error_code;
 }
 
@@ -579,13 +756,10 @@ Buffer* RSTStreamFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     return stream;
 }
 
-bool RSTStreamFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    if(len != 4) return false;
+bool RSTStreamFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    if(payload.Length() != 4) return false;
 
-    error_code_ = (uint32_t)buff[0] << 24 | \
-                 (uint32_t)buff[1] << 16 | \
-                 (uint32_t)buff[2] << 8 | \
-                 (uint32_t)buff[3];
+    error_code_ = payload.GetValue(4, 0);
 
     return true;
 }
@@ -601,8 +775,7 @@ SettingsFrame::SettingsFrame() {
     type_ = TYPE_SETTINGS_FRAME;
 }
 
-SettingsFrame::SettingsFrame(lhttp2::Settings settings) {
-    SettingsFrame();
+SettingsFrame::SettingsFrame(lhttp2::Settings settings) : SettingsFrame() {
     settings_ = settings;
     UpdateLength();
 }
@@ -619,6 +792,10 @@ void SettingsFrame::set_settings(lhttp2::Settings& settings) {
     UpdateLength();
 }
 
+bool SettingsFrame::has_parameter(SETTINGS_PARAMETERS id) const {
+    return (parameters_ & (1 << id)) != 0;
+}
+
 bool SettingsFrame::has_ack_flag() {
     return has_flags(FLAG_ACK);
 }
@@ -680,21 +857,20 @@ Buffer* SettingsFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     return stream;
 }
 
-bool SettingsFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    if(len % 6 != 0) return false;
+bool SettingsFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    if(payload.Length() % 6 != 0) return false;
 
-    int i, set_cnt = len / 6;
+    int i, set_cnt = payload.Length() / 6;
     uint32_t id, val;
     lhttp2::Settings settings;
 
+    parameters_ = 0;
+
     for(i = 0; i < set_cnt; i++) {
-        id = (uint32_t)buff[i * 6] << 8 | \
-             (uint32_t)buff[i * 6 + 1];
+        id = payload.GetValue(2, i * 6);
+        val = payload.GetValue(4, i * 6 + 2);
 
-        val = (uint32_t)buff[i * 6 + 2] << 24 | \
-              (uint32_t)buff[i * 6 + 3] << 16 | \
-              (uint32_t)buff[i * 6 + 4] << 8 | \
-              (uint32_t)buff[i * 6 + 5];
+        if(id >= SETTINGS_HEADER_TABLE_SIZE && id <= SETTINGS_MAX_HEADER_LIST_SIZE) parameters_ = parameters_ | (1 << id);
 
         if(id == SETTINGS_HEADER_TABLE_SIZE) settings.set_header_table_size(val);
         else if(id == SETTINGS_ENABLE_PUSH) settings.set_enable_push(val);
@@ -740,11 +916,9 @@ PushPromisFrame::PushPromisFrame() {
     length_ = 4;
 }
 
-PushPromisFrame::PushPromisFrame(uint32_t promised_stream_id, Buffer header_block_fragment, uint8_t pad_length) {
-    PushPromisFrame();
-
+PushPromisFrame::PushPromisFrame(uint32_t promised_stream_id, Buffer header_block_fragment, uint8_t pad_length) : PushPromisFrame() {
     promised_stream_id_ = promised_stream_id;
-    header_block_fragment_ = header_block_fragment;
+    header_block_fragment_ = std::move(header_block_fragment);
 
     pad_length_ = pad_length;
     if(pad_length_ > 0) set_flags(FLAG_PADDED);
@@ -772,6 +946,14 @@ const Buffer& PushPromisFrame::header_block_fragment() const {
     return header_block_fragment_;
 }
 
+const hpack::HeaderList& PushPromisFrame::header_list() const {
+    return header_list_;
+}
+
+const bool PushPromisFrame::header_list_oversized() const {
+    return header_list_oversized_;
+}
+
 void PushPromisFrame::set_pad_length(uint8_t pad_length) {
     pad_length_ = pad_length;
 }
@@ -789,6 +971,11 @@ void PushPromisFrame::set_header_block_fragment(Buffer& header_block_fragment) {
     UpdateLength();
 }
 
+void PushPromisFrame::set_header_block_fragment(Buffer&& header_block_fragment) {
+    header_block_fragment_ = std::move(header_block_fragment);
+    UpdateLength();
+}
+
 bool PushPromisFrame::has_end_headers_flag() {
     return has_flags(FLAG_END_HEADERS);
 }
@@ -830,21 +1017,35 @@ Buffer* PushPromisFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     return stream;
 }
 
-bool PushPromisFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    int idx = 0;
+bool PushPromisFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    int idx = 0, len = payload.Length();
 
+    pad_length_ = 0;
     if(has_padded_flag()) {
-        pad_length_ = buff[idx];
+        if(len < 1) return false;
+        pad_length_ = payload.GetValue(1, idx);
         idx = idx + 1;
     }
 
-    reserved_ = ((buff[idx] & 0x80) == 0x80);
-    promised_stream_id_ = (uint32_t)(buff[idx] & 0x7F) << 24 | \
-                        (uint32_t)buff[idx + 1] << 16 | \
-                        (uint32_t)buff[idx + 2] << 8 | \
-                        (uint32_t)buff[idx + 3];
-    
-    header_block_fragment_ = Buffer(buff + idx + 4, len - pad_length_ - idx);
+    if(len - idx < 4 || pad_length_ > len - idx - 4) return false;
+
+    reserved_ = ((payload.Get(idx) & 0x80) == 0x80);
+    promised_stream_id_ = payload.GetValue(4, idx) & 0x7FFFFFFF;
+
+    header_block_fragment_.Copy(payload.Slice(idx + 4, len - pad_length_ - idx - 4));
+    header_list_.Clear();
+    header_list_oversized_ = false;
+
+    // The promised request's header block updates the decoder's table like any other.
+    if(block_decoder_ != nullptr) {
+        if(block_decoder_->Decode(hpack_table, header_block_fragment_, header_list_) == false) return false;
+        if(has_end_headers_flag() && block_decoder_->End() == false) return false;
+        header_list_oversized_ = block_decoder_->Oversized();
+        if(header_list_oversized_ == true) header_list_.Clear();
+    }
+    else if(has_end_headers_flag() && hpack_table.Decode(header_list_, header_block_fragment_) == false) {
+        return false;
+    }
     UpdateLength();
 
     return true;
@@ -865,8 +1066,7 @@ PingFrame::PingFrame() {
     length_ = 8;
 }
 
-PingFrame::PingFrame(uint64_t opaque_data) {
-    PingFrame();
+PingFrame::PingFrame(uint64_t opaque_data) : PingFrame() {
     opaque_data_ = opaque_data;
 }
 
@@ -901,15 +1101,10 @@ Buffer* PingFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     return stream;
 }
 
-bool PingFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    opaque_data_ = (uint64_t)buff[0] << 56 | \
-                  (uint64_t)buff[1] << 48 | \
-                  (uint64_t)buff[2] << 40 | \
-                  (uint64_t)buff[3] << 32 | \
-                  (uint64_t)buff[4] << 24 | \
-                  (uint64_t)buff[5] << 16 | \
-                  (uint64_t)buff[6] << 8 | \
-                  (uint64_t)buff[7];
+bool PingFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    if(payload.Length() != 8) return false;
+
+    opaque_data_ = payload.GetValue(8, 0);
 
     UpdateLength();
 
@@ -928,12 +1123,10 @@ GoawayFrame::GoawayFrame() {
     length_ = 8;
 }
 
-GoawayFrame::GoawayFrame(uint32_t last_stream_id, uint32_t error_code, Buffer additional_debug_data) {
-    GoawayFrame();
-
+GoawayFrame::GoawayFrame(uint32_t last_stream_id, uint32_t error_code, Buffer additional_debug_data) : GoawayFrame() {
     last_stream_id_ = last_stream_id;
     error_code_ = error_code;
-    additional_debug_data_ = additional_debug_data;
+    additional_debug_data_ = std::move(additional_debug_data);
 
     UpdateLength();
 }
@@ -974,6 +1167,11 @@ void GoawayFrame::set_additional_debug_data(Buffer& additional_debug_data) {
     UpdateLength();
 }
 
+void GoawayFrame::set_additional_debug_data(Buffer&& additional_debug_data) {
+    additional_debug_data_ = std::move(additional_debug_data);
+    UpdateLength();
+}
+
 Buffer* GoawayFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     Buffer *stream = new Buffer(8 + additional_debug_data_.Length());
 
@@ -984,20 +1182,14 @@ Buffer* GoawayFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     return stream;
 }
 
-bool GoawayFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    reserved_ = ((buff[0] & 0x80) == 0x80);
-
-    last_stream_id_ = (uint32_t)(buff[0] & 0x7F) << 24 | \
-                    (uint32_t)buff[1] << 16 | \
-                    (uint32_t)buff[2] << 8 | \
-                    (uint32_t)buff[3];
+bool GoawayFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    if(payload.Length() < 8) return false;
 
-    error_code_ = (uint32_t)(buff[4] & 0x7F) << 24 | \
-                (uint32_t)buff[5] << 16 | \
-                (uint32_t)buff[6] << 8 | \
-                (uint32_t)buff[7];
+    reserved_ = ((payload.Get(0) & 0x80) == 0x80);
+    last_stream_id_ = payload.GetValue(4, 0) & 0x7FFFFFFF;
+    error_code_ = payload.GetValue(4, 4);
 
-    additional_debug_data_ = Buffer(buff + 8, len - 8);
+    additional_debug_data_.Copy(payload.Slice(8));
 
     UpdateLength();
 
@@ -1016,8 +1208,7 @@ WindowUpdateFrame::WindowUpdateFrame() {
     length_ = 4;
 }
 
-WindowUpdateFrame::WindowUpdateFrame(uint32_t window_size_increment) {
-    WindowUpdateFrame();
+WindowUpdateFrame::WindowUpdateFrame(uint32_t window_size_increment) : WindowUpdateFrame() {
     window_size_increment_ = window_size_increment;
 }
 
@@ -1048,13 +1239,11 @@ Buffer* WindowUpdateFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     return stream;
 }
 
-bool WindowUpdateFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    reserved_ = ((buff[0] & 0x80) == 0x80);
+bool WindowUpdateFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    if(payload.Length() != 4) return false;
 
-    window_size_increment_ = (uint32_t)(buff[0] & 0x7F) << 24 | \
-                            (uint32_t)buff[1] << 16 | \
-                            (uint32_t)buff[2] << 8 | \
-                            (uint32_t)buff[3];
+    reserved_ = ((payload.Get(0) & 0x80) == 0x80);
+    window_size_increment_ = payload.GetValue(4, 0) & 0x7FFFFFFF;
 
     UpdateLength();
 
@@ -1072,9 +1261,8 @@ ContinuationFrame::ContinuationFrame() {
     type_ = TYPE_CONTINUATION_FRAME;
 }
 
-ContinuationFrame::ContinuationFrame(Buffer& header_block_fragment) {
-    ContinuationFrame();
-    header_block_fragment_ = header_block_fragment;
+ContinuationFrame::ContinuationFrame(Buffer header_block_fragment) : ContinuationFrame() {
+    header_block_fragment_ = std::move(header_block_fragment);
     UpdateLength();
 }
 
@@ -1085,11 +1273,24 @@ const Buffer& ContinuationFrame::header_block_fragment() const {
     return header_block_fragment_;
 }
 
+const hpack::HeaderList& ContinuationFrame::header_list() const {
+    return header_list_;
+}
+
+const bool ContinuationFrame::header_list_oversized() const {
+    return header_list_oversized_;
+}
+
 void ContinuationFrame::set_header_block_fragment(Buffer& header_block_fragment) {
     header_block_fragment_ = header_block_fragment;
     UpdateLength();
 }
 
+void ContinuationFrame::set_header_block_fragment(Buffer&& header_block_fragment) {
+    header_block_fragment_ = std::move(header_block_fragment);
+    UpdateLength();
+}
+
 bool ContinuationFrame::has_end_headers_flag() {
     return has_flags(FLAG_END_HEADERS);
 }
@@ -1102,13 +1303,33 @@ void ContinuationFrame::clear_end_headers_flag() {
     clear_flags(FLAG_END_HEADERS);
 }
 
+void ContinuationFrame::EncodeFrameSegments(hpack::Table& hpack_table, FrameWriter& writer) {
+    char header_buff[FRAME_HEADER_SIZE];
+
+    UpdateLength();
+    EncodeFrameHeader(header_buff, length_);
+
+    writer.AppendCopy(header_buff, FRAME_HEADER_SIZE);
+    writer.AppendReference(header_block_fragment_.Address(), header_block_fragment_.Length());
+}
+
 Buffer* ContinuationFrame::EncodeFramePayload(hpack::Table& hpack_table) {
     Buffer *stream = new Buffer(header_block_fragment_);
     return stream;
 }
 
-bool ContinuationFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    header_block_fragment_ = Buffer(buff, len);
+bool ContinuationFrame::DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) {
+    header_block_fragment_.Copy(payload);
+    header_list_.Clear();
+    header_list_oversized_ = false;
+
+    if(block_decoder_ != nullptr) {
+        if(block_decoder_->Decode(hpack_table, payload, header_list_) == false) return false;
+        if(has_end_headers_flag() && block_decoder_->End() == false) return false;
+        header_list_oversized_ = block_decoder_->Oversized();
+        if(header_list_oversized_ == true) header_list_.Clear();
+    }
+
     UpdateLength();
     return true;
 }
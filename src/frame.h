@@ -4,13 +4,19 @@
 #include <string>
 #include <cstdint>
 
-#include "buffer/Buffer.h"
+#include "buffer/buffer.h"
+#include "buffer/ring_buffer.h"
 #include "hpack/hpack.h"
+#include "hpack/block_decoder.h"
 #include "settings.h"
 #include "error.h"
 
+#define FRAME_HEADER_SIZE 9
+
 namespace lhttp2 {
     class Frame;                  // Header of frame
+    class FrameWriter;
+    class FrameParser;
 
     /*
         Classes below are payload classes.
@@ -84,10 +90,17 @@ namespace lhttp2 {
         static int SendFrame(const int fd, Frame* frame, hpack::Table& hpack_table, bool debug = false);
         static const std::string GetFrameTypeName(FRAME_TYPE type);
 
+        static Frame* CreateFrame(FRAME_TYPE type);
+        static Frame* DecodeFrame(const char* header_buff, const BufferView& payload, hpack::Table& hpack_table, bool debug = false);
+        static bool DecodeFrame(Frame* frame, const char* header_buff, const BufferView& payload, hpack::Table& hpack_table, bool debug = false);
+
     protected:
-        Buffer* EncodeFrame(hpack::Table& hpack_table);
+        friend class FrameWriter;
+
+        void EncodeFrameHeader(char* header_buff, const uint32_t length) const;
+        virtual void EncodeFrameSegments(hpack::Table& hpack_table, FrameWriter& writer);
         virtual Buffer* EncodeFramePayload(hpack::Table& hpack_table) = 0;
-        virtual bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) = 0;
+        virtual bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) = 0;
         virtual void UpdateLength() = 0;
 
         uint32_t length_ = 0;
@@ -107,6 +120,13 @@ namespace lhttp2 {
         DATA frames MAY also contain padding.  Padding can be added to DATA
         frames to obscure the size of messages.  Padding is a security feature.
 
+        A received DATA frame can be decoded as a view into the receive
+        buffer instead of a copy (Connection::UseZeroCopyData). Its data is
+        then read through data_address()/data_length(), data() is empty,
+        and the bytes stay valid until ReleaseData() or the frame is
+        destroyed or recycled, whichever comes first. A frame to be sent
+        can likewise reference its data, e.g. a slice of a BufferChain.
+
         +---------------+
         |Pad Length? (8)|
         +---------------+-----------------------------------------------+
@@ -121,11 +141,22 @@ namespace lhttp2 {
         DataFrame(Buffer data, uint8_t pad_length = 0);
         ~DataFrame();
 
+        DataFrame(const DataFrame&) = delete;
+        DataFrame& operator=(const DataFrame&) = delete;
+
         const uint8_t pad_length() const;
         const Buffer& data() const;
 
+        const BufferView data_view() const;
+        const char* data_address() const;
+        const uint32_t data_length() const;
+        bool is_data_view() const;
+
         void set_pad_length(uint8_t pad_length);
         void set_data(Buffer& data);
+        void set_data(Buffer&& data);
+        void set_data(const BufferView& data);
+        void ReleaseData();
 
         bool has_end_stream_flag() const;
         bool has_padded_flag() const;
@@ -137,12 +168,22 @@ namespace lhttp2 {
         void clear_padded_flag();
 
     private:
+        void EncodeFrameSegments(hpack::Table& hpack_table, FrameWriter& writer) override;
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
+        friend class FrameParser;
+
         uint8_t pad_length_ = 0;
         Buffer data_;
+
+        // View mode: data lives outside the frame. When it lives in the
+        // connection's receive buffer it stays pinned until ReleaseData().
+        RingBuffer* view_source_ = nullptr;
+        RingBuffer* view_buffer_ = nullptr;
+        uint64_t view_position_ = 0;
+        BufferView view_;
     };
 
     /*
@@ -176,8 +217,9 @@ namespace lhttp2 {
         const bool exclusive() const;
         const uint32_t stream_dependency() const;
         const uint8_t weight() const;
-        const std::vector<hpack::HeaderFieldRepresentation>& header_list() const;
+        const hpack::HeaderList& header_list() const;
         const Buffer& header_block_fragment() const;
+        const bool header_list_oversized() const;
 
         void set_pad_length(uint8_t pad_length);
         void set_exclusive(bool exclusive);
@@ -203,16 +245,27 @@ namespace lhttp2 {
         void clear_priority_flag();
 
     private:
+        void EncodeFrameSegments(hpack::Table& hpack_table, FrameWriter& writer) override;
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
+        void EncodeHeaderBlock(hpack::Table& hpack_table, bool update);
+
+        friend class FrameParser;
+
         uint8_t pad_length_ = 0;
         bool exclusive_ = false;
         uint32_t stream_dependency_ = 0;
         uint8_t weight_ = 0;
-        std::vector<hpack::HeaderFieldRepresentation> header_list_;
+        std::vector<hpack::HeaderFieldRepresentation> header_fields_;
+        hpack::HeaderList header_list_;
         Buffer header_;
+
+        // Set by the parser while decoding, so a block continued by
+        // CONTINUATION frames is decoded as its fragments arrive.
+        hpack::BlockDecoder* block_decoder_ = nullptr;
+        bool header_list_oversized_ = false;
     };
 
     /*
@@ -244,7 +297,7 @@ namespace lhttp2 {
 
     private:
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         bool exclusive_ = false;
@@ -275,7 +328,7 @@ namespace lhttp2 {
 
     private:
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         uint32_t error_code_ = 0;
@@ -314,16 +367,21 @@ namespace lhttp2 {
         const lhttp2::Settings& settings() const;
         void set_settings(lhttp2::Settings& settings);
 
+        // Whether a received frame carried the parameter. Those it left out
+        // keep the value the peer set before, not the default in settings().
+        bool has_parameter(SETTINGS_PARAMETERS id) const;
+
         bool has_ack_flag();
         void set_ack_flag();
         void clear_ack_flag();
 
     private:
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         lhttp2::Settings settings_;
+        uint32_t parameters_ = 0;
     };
 
     /*
@@ -355,11 +413,14 @@ namespace lhttp2 {
         const bool reserved() const;
         const uint32_t promised_stream_id() const;
         const Buffer& header_block_fragment() const;
+        const hpack::HeaderList& header_list() const;
+        const bool header_list_oversized() const;
 
         void set_pad_length(uint8_t pad_length);
         void set_reserved(bool reserved);
         void set_promised_stream_id(uint32_t promised_stream_id);
         void set_header_block_fragment(Buffer& header_block_fragment);
+        void set_header_block_fragment(Buffer&& header_block_fragment);
 
         bool has_end_headers_flag();
         bool has_padded_flag();
@@ -372,13 +433,18 @@ namespace lhttp2 {
 
     private:
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
+        friend class FrameParser;
+
         uint8_t pad_length_ = 0;
         bool reserved_ = false;
         uint32_t promised_stream_id_;
         Buffer header_block_fragment_;
+        hpack::HeaderList header_list_;
+        hpack::BlockDecoder* block_decoder_ = nullptr;
+        bool header_list_oversized_ = false;
     };
 
     /*
@@ -410,7 +476,7 @@ namespace lhttp2 {
 
     private:
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         uint64_t opaque_data_ = 0;
@@ -448,10 +514,11 @@ namespace lhttp2 {
         void set_last_stream_id(uint32_t last_stream_id);
         void set_error_code(uint32_t error_code);
         void set_additional_debug_data(Buffer& additional_debug_data);
+        void set_additional_debug_data(Buffer&& additional_debug_data);
 
     private:
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         bool reserved_ = false;
@@ -483,7 +550,7 @@ namespace lhttp2 {
 
     private:
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         bool reserved_ = false;
@@ -498,6 +565,10 @@ namespace lhttp2 {
         as long as the preceding frame is on the same stream and is a HEADERS, 
         PUSH_PROMISE, or CONTINUATION frame without the END_HEADERS flag set.
 
+        Frames received through a FrameParser carry in header_list() the
+        fields that their fragment completed, after those of the frames
+        before them in the block.
+
         +---------------------------------------------------------------+
         |                   Header Block Fragment (*)                 ...
         +---------------------------------------------------------------+
@@ -505,22 +576,31 @@ namespace lhttp2 {
     class ContinuationFrame final : public Frame {
     public:
         ContinuationFrame();
-        ContinuationFrame(Buffer& header_block_fragment);
+        ContinuationFrame(Buffer header_block_fragment);
         ~ContinuationFrame();
 
         const Buffer& header_block_fragment() const;
+        const hpack::HeaderList& header_list() const;
+        const bool header_list_oversized() const;
         void set_header_block_fragment(Buffer& header_block_fragment);
+        void set_header_block_fragment(Buffer&& header_block_fragment);
 
         bool has_end_headers_flag();
         void set_end_headers_flag();
         void clear_end_headers_flag();
 
     private:
+        void EncodeFrameSegments(hpack::Table& hpack_table, FrameWriter& writer) override;
         Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
-        bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferView& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
+        friend class FrameParser;
+
         Buffer header_block_fragment_;
+        hpack::HeaderList header_list_;
+        hpack::BlockDecoder* block_decoder_ = nullptr;
+        bool header_list_oversized_ = false;
     };
 };
 
@@ -0,0 +1,227 @@
+#include <cstring>
+
+#include "frame_parser.h"
+
+using namespace lhttp2;
+
+FrameParser::FrameParser(uint32_t max_frame_size) : max_frame_size_(max_frame_size) {
+}
+
+FrameParser::~FrameParser() {
+}
+
+int FrameParser::Parse(const char* buff, const int len, std::vector<Frame*>& frames, hpack::Table& hpack_table, bool buffer_partial, bool debug) {
+    uint32_t idx = 0, copy_len, length;
+
+    if(state_ == STATE_ERROR || len < 0) {
+        return -1;
+    }
+
+    while(idx < (uint32_t)len) {
+        if(state_ == STATE_FRAME_HEADER) {
+            // Whole frame is inside the chunk, decode it in place.
+            if(header_len_ == 0 && len - idx >= FRAME_HEADER_SIZE) {
+                if(CheckFrameHeader(buff + idx, length) == false) {
+                    return -1;
+                }
+
+                if(len - idx - FRAME_HEADER_SIZE >= length) {
+                    if(EmitFrame(buff + idx, buff + idx + FRAME_HEADER_SIZE, length, true, frames, hpack_table, debug) == false) {
+                        return -1;
+                    }
+                    idx = idx + FRAME_HEADER_SIZE + length;
+                    continue;
+                }
+            }
+
+            if(header_len_ == 0 && buffer_partial == false) {
+                break;
+            }
+
+            copy_len = FRAME_HEADER_SIZE - header_len_;
+            if(copy_len > len - idx) copy_len = len - idx;
+
+            memcpy(header_buff_ + header_len_, buff + idx, copy_len);
+            header_len_ = header_len_ + copy_len;
+            idx = idx + copy_len;
+
+            if(header_len_ < FRAME_HEADER_SIZE) {
+                break;
+            }
+
+            if(CheckFrameHeader(header_buff_, payload_len_) == false) {
+                return -1;
+            }
+
+            payload_.Clear();
+            state_ = STATE_FRAME_PAYLOAD;
+        }
+
+        copy_len = payload_len_ - payload_.Length();
+        if(copy_len > len - idx) copy_len = len - idx;
+
+        payload_.Append(buff + idx, copy_len);
+        idx = idx + copy_len;
+
+        if(payload_.Length() == payload_len_) {
+            if(EmitFrame(header_buff_, payload_.Address(), payload_len_, false, frames, hpack_table, debug) == false) {
+                return -1;
+            }
+            header_len_ = 0;
+            state_ = STATE_FRAME_HEADER;
+        }
+    }
+
+    return idx;
+}
+
+void FrameParser::Reset() {
+    state_ = STATE_FRAME_HEADER;
+    error_ = HTTP2_ERROR_NO_ERROR;
+    header_len_ = 0;
+    payload_len_ = 0;
+    payload_.Clear();
+    block_decoder_.End();
+    header_block_stream_ = 0;
+}
+
+const FrameParser::PARSER_STATE FrameParser::state() const {
+    return state_;
+}
+
+const HTTP2_ERROR_CODE FrameParser::error() const {
+    return error_;
+}
+
+const uint32_t FrameParser::max_frame_size() const {
+    return max_frame_size_;
+}
+
+const uint32_t FrameParser::max_header_list_size() const {
+    return max_header_list_size_;
+}
+
+FramePool* FrameParser::frame_pool() const {
+    return frame_pool_;
+}
+
+RingBuffer* FrameParser::recv_buffer() const {
+    return recv_buffer_;
+}
+
+void FrameParser::set_max_frame_size(uint32_t max_frame_size) {
+    max_frame_size_ = max_frame_size;
+}
+
+void FrameParser::set_max_header_list_size(uint32_t max_header_list_size) {
+    max_header_list_size_ = max_header_list_size;
+}
+
+void FrameParser::set_frame_pool(FramePool* frame_pool) {
+    frame_pool_ = frame_pool;
+}
+
+void FrameParser::set_recv_buffer(RingBuffer* recv_buffer) {
+    recv_buffer_ = recv_buffer;
+}
+
+bool FrameParser::CheckFrameHeader(const char* header_buff, uint32_t& length) {
+    const uint8_t* header = (const uint8_t*)header_buff;
+
+    length = (uint32_t)header[0] << 16 | \
+             (uint32_t)header[1] << 8 | \
+             (uint32_t)header[2];
+
+    if(length > max_frame_size_) {
+        SetError(HTTP2_ERROR_FRAME_SIZE_ERROR);
+        return false;
+    }
+
+    switch((Frame::FRAME_TYPE)header[3]) {
+        case Frame::TYPE_PRIORITY_FRAME: if(length != 5) break; return true;
+        case Frame::TYPE_RST_STREAM_FRAME: if(length != 4) break; return true;
+        case Frame::TYPE_SETTINGS_FRAME: if(length % 6 != 0) break; return true;
+        case Frame::TYPE_PING_FRAME: if(length != 8) break; return true;
+        case Frame::TYPE_GOAWAY_FRAME: if(length < 8) break; return true;
+        case Frame::TYPE_WINDOW_UPDATE_FRAME: if(length != 4) break; return true;
+        default: return true;
+    }
+
+    SetError(HTTP2_ERROR_FRAME_SIZE_ERROR);
+    return false;
+}
+
+// A header block must be continued by CONTINUATION frames on its own stream
+// and by nothing else, and CONTINUATION frames may not appear outside one.
+bool FrameParser::CheckHeaderBlock(const char* header_buff) {
+    const uint8_t* header = (const uint8_t*)header_buff;
+    uint32_t stream_id = (uint32_t)(header[5] & 0x7F) << 24 | \
+                         (uint32_t)header[6] << 16 | \
+                         (uint32_t)header[7] << 8 | \
+                         (uint32_t)header[8];
+
+    if(block_decoder_.InBlock()) {
+        if(header[3] == Frame::TYPE_CONTINUATION_FRAME && stream_id == header_block_stream_) return true;
+    }
+    else {
+        if(header[3] != Frame::TYPE_CONTINUATION_FRAME) {
+            if(header[3] == Frame::TYPE_HEADERS_FRAME || header[3] == Frame::TYPE_PUSH_PROMISE_FRAME) {
+                block_decoder_.Begin(max_header_list_size_);
+                header_block_stream_ = stream_id;
+            }
+            return true;
+        }
+    }
+
+    SetError(HTTP2_ERROR_PROTOCOL_ERROR);
+    return false;
+}
+
+bool FrameParser::EmitFrame(const char* header_buff, const char* payload_buff, const uint32_t length, bool in_place, std::vector<Frame*>& frames, hpack::Table& hpack_table, bool debug) {
+    if(CheckHeaderBlock(header_buff) == false) {
+        return false;
+    }
+
+    // Implementations MUST ignore and discard any frame that has a type that is unknown.
+    if((uint8_t)header_buff[3] > Frame::TYPE_CONTINUATION_FRAME) {
+        return true;
+    }
+
+    Frame::FRAME_TYPE type = (Frame::FRAME_TYPE)(uint8_t)header_buff[3];
+    Frame* frame = (frame_pool_ != nullptr) ? frame_pool_->Acquire(type) : Frame::CreateFrame(type);
+
+    if(type == Frame::TYPE_DATA_FRAME && in_place == true) {
+        ((DataFrame*)frame)->view_source_ = recv_buffer_;
+    }
+    else if(type == Frame::TYPE_HEADERS_FRAME) ((HeadersFrame*)frame)->block_decoder_ = &block_decoder_;
+    else if(type == Frame::TYPE_PUSH_PROMISE_FRAME) ((PushPromisFrame*)frame)->block_decoder_ = &block_decoder_;
+    else if(type == Frame::TYPE_CONTINUATION_FRAME) ((ContinuationFrame*)frame)->block_decoder_ = &block_decoder_;
+
+    bool decoded = Frame::DecodeFrame(frame, header_buff, BufferView(payload_buff, length), hpack_table, debug);
+
+    if(type == Frame::TYPE_DATA_FRAME) ((DataFrame*)frame)->view_source_ = nullptr;
+    else if(type == Frame::TYPE_HEADERS_FRAME) ((HeadersFrame*)frame)->block_decoder_ = nullptr;
+    else if(type == Frame::TYPE_PUSH_PROMISE_FRAME) ((PushPromisFrame*)frame)->block_decoder_ = nullptr;
+    else if(type == Frame::TYPE_CONTINUATION_FRAME) ((ContinuationFrame*)frame)->block_decoder_ = nullptr;
+
+    if(decoded == false) {
+        if(frame_pool_ != nullptr) frame_pool_->Release(frame);
+        else delete frame;
+        frame = nullptr;
+    }
+
+    if(frame == nullptr) {
+        if(block_decoder_.Refused()) SetError(HTTP2_ERROR_ENHANCE_YOUR_CALM);
+        else if(type == Frame::TYPE_HEADERS_FRAME || type == Frame::TYPE_PUSH_PROMISE_FRAME || type == Frame::TYPE_CONTINUATION_FRAME) SetError(HTTP2_ERROR_COMPRESSION_ERROR);
+        else SetError(HTTP2_ERROR_PROTOCOL_ERROR);
+        return false;
+    }
+
+    frames.push_back(frame);
+    return true;
+}
+
+void FrameParser::SetError(HTTP2_ERROR_CODE error) {
+    state_ = STATE_ERROR;
+    error_ = error;
+}
@@ -0,0 +1,96 @@
+#ifndef _LHTTP2_FRAME_PARSER_H_
+#define _LHTTP2_FRAME_PARSER_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "buffer/buffer.h"
+#include "buffer/ring_buffer.h"
+#include "hpack/hpack.h"
+#include "hpack/block_decoder.h"
+#include "frame.h"
+#include "frame_pool.h"
+#include "error.h"
+
+namespace lhttp2 {
+    /*
+        ### Frame parser ###
+
+        FrameParser turns the byte chunks returned by a non-blocking socket
+        into frames. Chunks may be cut anywhere: a frame header or payload
+        that is split across chunks is kept inside the parser until the rest
+        of it arrives, so one call can emit zero, one or many frames.
+
+        Frames that are complete inside a chunk are decoded straight from the
+        chunk without being copied into the parser. When buffer_partial is
+        false, a trailing incomplete frame is left unconsumed instead of being
+        copied, so a caller that owns the chunk memory can parse it in place
+        once the rest of the frame has been read behind it.
+
+        With a frame pool set, frames are taken from the pool instead of
+        being allocated, and the caller gives them back with
+        FramePool::Release() or through a FrameHandle.
+
+        With a receive buffer set, DATA frames decoded in place are handed
+        out as views pinned in that buffer instead of copies. Chunks passed
+        to Parse() must then come from the receive buffer.
+
+        A header block split over HEADERS or PUSH_PROMISE and CONTINUATION
+        frames is decoded fragment by fragment, each frame carrying the
+        fields it completed. Any other frame inside the block is a
+        PROTOCOL_ERROR, and a block that fails to decode a COMPRESSION_ERROR.
+        A block that grows beyond the maximum header list size is decoded to
+        the end all the same, its frames flagged header_list_oversized() so
+        only its stream is refused. A single field too large to buffer ends
+        the connection with ENHANCE_YOUR_CALM.
+    */
+    class FrameParser {
+    public:
+        typedef enum _PARSER_STATE {
+            STATE_FRAME_HEADER,
+            STATE_FRAME_PAYLOAD,
+            STATE_ERROR,
+        } PARSER_STATE;
+
+        FrameParser(uint32_t max_frame_size = 0x4000);
+        ~FrameParser();
+
+        int Parse(const char* buff, const int len, std::vector<Frame*>& frames, hpack::Table& hpack_table, bool buffer_partial = true, bool debug = false);
+        void Reset();
+
+        const PARSER_STATE state() const;
+        const HTTP2_ERROR_CODE error() const;
+        const uint32_t max_frame_size() const;
+        const uint32_t max_header_list_size() const;
+        FramePool* frame_pool() const;
+        RingBuffer* recv_buffer() const;
+
+        void set_max_frame_size(uint32_t max_frame_size);
+        void set_max_header_list_size(uint32_t max_header_list_size);
+        void set_frame_pool(FramePool* frame_pool);
+        void set_recv_buffer(RingBuffer* recv_buffer);
+
+    private:
+        bool CheckFrameHeader(const char* header_buff, uint32_t& length);
+        bool CheckHeaderBlock(const char* header_buff);
+        bool EmitFrame(const char* header_buff, const char* payload_buff, const uint32_t length, bool in_place, std::vector<Frame*>& frames, hpack::Table& hpack_table, bool debug);
+        void SetError(HTTP2_ERROR_CODE error);
+
+        PARSER_STATE state_ = STATE_FRAME_HEADER;
+        HTTP2_ERROR_CODE error_ = HTTP2_ERROR_NO_ERROR;
+        uint32_t max_frame_size_;
+        uint32_t max_header_list_size_ = UINT32_MAX;
+        FramePool* frame_pool_ = nullptr;
+        RingBuffer* recv_buffer_ = nullptr;
+
+        char header_buff_[FRAME_HEADER_SIZE];
+        uint32_t header_len_ = 0;
+        uint32_t payload_len_ = 0;
+        Buffer payload_;
+
+        hpack::BlockDecoder block_decoder_;
+        uint32_t header_block_stream_ = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "frame_pool.h"
+
+using namespace lhttp2;
+
+/*
+    Implementation of frame handle
+*/
+FrameHandle::FrameHandle() {
+}
+
+FrameHandle::FrameHandle(Frame* frame, FramePool* pool) : frame_(frame), pool_(pool) {
+}
+
+FrameHandle::FrameHandle(FrameHandle&& handle) : frame_(handle.frame_), pool_(handle.pool_) {
+    handle.frame_ = nullptr;
+    handle.pool_ = nullptr;
+}
+
+FrameHandle::~FrameHandle() {
+    reset();
+}
+
+FrameHandle& FrameHandle::operator=(FrameHandle&& handle) {
+    if(this != &handle) {
+        reset();
+        frame_ = handle.frame_;
+        pool_ = handle.pool_;
+        handle.frame_ = nullptr;
+        handle.pool_ = nullptr;
+    }
+    return *this;
+}
+
+Frame* FrameHandle::get() const {
+    return frame_;
+}
+
+Frame* FrameHandle::release() {
+    Frame* frame = frame_;
+    frame_ = nullptr;
+    pool_ = nullptr;
+    return frame;
+}
+
+void FrameHandle::reset() {
+    if(frame_ == nullptr) return;
+
+    if(pool_ != nullptr) pool_->Release(frame_);
+    else delete frame_;
+
+    frame_ = nullptr;
+    pool_ = nullptr;
+}
+
+Frame* FrameHandle::operator->() const {
+    return frame_;
+}
+
+Frame& FrameHandle::operator*() const {
+    return *frame_;
+}
+
+FrameHandle::operator bool() const {
+    return frame_ != nullptr;
+}
+
+/*
+    Implementation of frame pool
+*/
+FramePool::FramePool(uint32_t max_free_frames) : max_free_frames_(max_free_frames) {
+}
+
+FramePool::~FramePool() {
+    for(int i = 0; i <= Frame::TYPE_CONTINUATION_FRAME; i++) {
+        for(size_t j = 0; j < free_frames_[i].size(); j++) {
+            delete free_frames_[i][j];
+        }
+    }
+}
+
+Frame* FramePool::Acquire(Frame::FRAME_TYPE type) {
+    if(type > Frame::TYPE_CONTINUATION_FRAME) {
+        return nullptr;
+    }
+
+    std::vector<Frame*>& free_frames = free_frames_[type];
+
+    if(free_frames.empty()) {
+        return Frame::CreateFrame(type);
+    }
+
+    Frame* frame = free_frames.back();
+    free_frames.pop_back();
+    return frame;
+}
+
+void FramePool::Release(Frame* frame) {
+    if(frame == nullptr) return;
+
+    // A recycled frame must not keep the receive buffer pinned.
+    if(frame->type() == Frame::TYPE_DATA_FRAME) {
+        ((DataFrame*)frame)->ReleaseData();
+    }
+
+    std::vector<Frame*>& free_frames = free_frames_[frame->type()];
+
+    if(free_frames.size() >= max_free_frames_) {
+        delete frame;
+        return;
+    }
+
+    if(free_frames.capacity() < max_free_frames_) {
+        free_frames.reserve(max_free_frames_);
+    }
+
+    free_frames.push_back(frame);
+}
+
+const uint32_t FramePool::max_free_frames() const {
+    return max_free_frames_;
+}
+
+void FramePool::set_max_free_frames(uint32_t max_free_frames) {
+    max_free_frames_ = max_free_frames;
+}
@@ -0,0 +1,72 @@
+#ifndef _LHTTP2_FRAME_POOL_H_
+#define _LHTTP2_FRAME_POOL_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "frame.h"
+
+namespace lhttp2 {
+    class FramePool;
+
+    /*
+        ### Frame handle ###
+
+        Move-only owner of a frame taken from a FramePool. The frame goes
+        back to its pool when the handle is destroyed or reset, instead of
+        being deleted. A handle must not outlive the pool it came from.
+    */
+    class FrameHandle {
+    public:
+        FrameHandle();
+        FrameHandle(Frame* frame, FramePool* pool);
+        FrameHandle(FrameHandle&& handle);
+        ~FrameHandle();
+
+        FrameHandle(const FrameHandle&) = delete;
+        FrameHandle& operator=(const FrameHandle&) = delete;
+        FrameHandle& operator=(FrameHandle&& handle);
+
+        Frame* get() const;
+        Frame* release();
+        void reset();
+
+        Frame* operator->() const;
+        Frame& operator*() const;
+        explicit operator bool() const;
+
+    private:
+        Frame* frame_ = nullptr;
+        FramePool* pool_ = nullptr;
+    };
+
+    /*
+        ### Frame pool ###
+
+        Per-connection free lists of frame objects, one per frame type.
+        Released frames keep the storage of their payload buffers, so a
+        recycled frame decodes the next payload of similar size without
+        touching the heap. Frames acquired from the pool may still be
+        deleted directly; the pool does not track frames it handed out.
+    */
+    class FramePool {
+    public:
+        FramePool(uint32_t max_free_frames = 64);
+        ~FramePool();
+
+        FramePool(const FramePool&) = delete;
+        FramePool& operator=(const FramePool&) = delete;
+
+        Frame* Acquire(Frame::FRAME_TYPE type);
+        void Release(Frame* frame);
+
+        const uint32_t max_free_frames() const;
+        void set_max_free_frames(uint32_t max_free_frames);
+
+    private:
+        std::vector<Frame*> free_frames_[Frame::TYPE_CONTINUATION_FRAME + 1];
+        uint32_t max_free_frames_;
+    };
+}
+
+#endif
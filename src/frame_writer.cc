@@ -0,0 +1,234 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <errno.h>
+#include <cstring>
+
+#include "frame_writer.h"
+
+using namespace lhttp2;
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Written segments, and written bytes of the scratch buffer, are dropped once
+// there are at least this many and they are half of what the writer holds.
+#define COMPACT_SEGMENTS 64
+#define COMPACT_BYTES 4096
+
+// Padding octets are always zero, so one block serves every padded frame.
+static const char padding[256] = { 0 };
+
+FrameWriter::FrameWriter() {
+}
+
+FrameWriter::~FrameWriter() {
+}
+
+void FrameWriter::Append(Frame* frame, hpack::Table& hpack_table) {
+    frame->EncodeFrameSegments(hpack_table, *this);
+}
+
+void FrameWriter::AppendCopy(const char* buff, const uint32_t len) {
+    if(len == 0) return;
+
+    // Adjacent copies share one segment.
+    if(segments_.size() > first_segment_ && segments_.back().address == nullptr && \
+       segments_.back().offset + segments_.back().length == scratch_.Length()) {
+        segments_.back().length = segments_.back().length + len;
+    }
+    else {
+        Segment segment = { nullptr, scratch_.Length(), len, false };
+        segments_.push_back(segment);
+    }
+
+    scratch_.Append(buff, len);
+    length_ = length_ + len;
+}
+
+void FrameWriter::AppendReference(const char* buff, const uint32_t len) {
+    if(len == 0) return;
+
+    if(len < copy_threshold_) {
+        AppendCopy(buff, len);
+        return;
+    }
+
+    Segment segment = { buff, 0, len, true };
+    segments_.push_back(segment);
+    borrowed_segments_++;
+    length_ = length_ + len;
+}
+
+void FrameWriter::AppendPadding(const uint32_t len) {
+    uint32_t remain = len, seg_len;
+
+    while(remain > 0) {
+        seg_len = remain < sizeof(padding) ? remain : sizeof(padding);
+        Segment segment = { padding, 0, seg_len, false };
+        segments_.push_back(segment);
+        length_ = length_ + seg_len;
+        remain = remain - seg_len;
+    }
+}
+
+// Writes as much as the socket accepts. Returns the number of bytes written,
+// which is less than Length() if the socket would block, or -1 on error.
+int FrameWriter::Flush(const int fd, const int flags) {
+    struct iovec iov[IOV_MAX];
+    struct msghdr msg;
+    size_t i, iov_cnt;
+    ssize_t len;
+    int total = 0;
+
+    while(first_segment_ < segments_.size()) {
+        for(i = first_segment_, iov_cnt = 0; i < segments_.size() && iov_cnt < IOV_MAX; i++, iov_cnt++) {
+            iov[iov_cnt].iov_base = (void *)SegmentAddress(segments_[i]);
+            iov[iov_cnt].iov_len = segments_[i].length;
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_cnt;
+
+        // More batches follow, tell the kernel not to push this one yet.
+        len = ::sendmsg(fd, &msg, flags | MSG_NOSIGNAL | (i < segments_.size() ? MSG_MORE : 0));
+
+        if(len < 0) {
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+
+        total = total + len;
+        length_ = length_ - len;
+
+        while(len > 0) {
+            Segment& segment = segments_[first_segment_];
+            if((size_t)len < segment.length) {
+                if(segment.address != nullptr) segment.address = segment.address + len;
+                else segment.offset = segment.offset + len;
+                segment.length = segment.length - len;
+                break;
+            }
+            len = len - segment.length;
+            if(segment.borrowed) borrowed_segments_--;
+            first_segment_++;
+        }
+    }
+
+    if(first_segment_ == segments_.size()) {
+        Clear();
+    }
+    else {
+        Compact();
+    }
+
+    return total;
+}
+
+// Copies every borrowed payload that is still queued into the writer,
+// so the frames it came from can be released before the next Flush().
+void FrameWriter::Detach() {
+    for(size_t i = first_segment_; i < segments_.size() && borrowed_segments_ > 0; i++) {
+        Segment& segment = segments_[i];
+        if(segment.borrowed == false) continue;
+
+        segment.offset = scratch_.Length();
+        scratch_.Append(segment.address, segment.length);
+        segment.address = nullptr;
+        segment.borrowed = false;
+        borrowed_segments_--;
+    }
+}
+
+// Drops queued bytes from the end until len are left, taking back what was
+// appended but has not been written yet.
+void FrameWriter::Truncate(const uint32_t len) {
+    uint32_t excess;
+
+    while(length_ > len && segments_.size() > first_segment_) {
+        Segment& segment = segments_.back();
+        excess = length_ - len;
+
+        if(excess < segment.length) {
+            segment.length = segment.length - excess;
+            if(segment.address == nullptr) scratch_.Resize(segment.offset + segment.length);
+            length_ = len;
+            break;
+        }
+
+        if(segment.address == nullptr) scratch_.Resize(segment.offset);
+        if(segment.borrowed) borrowed_segments_--;
+        length_ = length_ - segment.length;
+        segments_.pop_back();
+    }
+}
+
+void FrameWriter::Clear() {
+    segments_.clear();
+    first_segment_ = 0;
+    length_ = 0;
+    borrowed_segments_ = 0;
+    scratch_.Clear();
+}
+
+bool FrameWriter::Empty() const {
+    return length_ == 0;
+}
+
+bool FrameWriter::Borrowed() const {
+    return borrowed_segments_ > 0;
+}
+
+const uint32_t FrameWriter::Length() const {
+    return length_;
+}
+
+const uint32_t FrameWriter::copy_threshold() const {
+    return copy_threshold_;
+}
+
+void FrameWriter::set_copy_threshold(uint32_t copy_threshold) {
+    copy_threshold_ = copy_threshold;
+}
+
+void FrameWriter::Print() const {
+    for(size_t i = first_segment_; i < segments_.size(); i++) {
+        Buffer::PrintBuffer(SegmentAddress(segments_[i]), segments_[i].length);
+    }
+}
+
+// Moves what is left to write to the front, so a writer that keeps being
+// appended to while it never drains does not hold on to what it wrote.
+void FrameWriter::Compact() {
+    uint32_t live = scratch_.Length();
+    size_t i;
+
+    if(first_segment_ >= COMPACT_SEGMENTS && first_segment_ * 2 >= segments_.size()) {
+        segments_.erase(segments_.begin(), segments_.begin() + first_segment_);
+        first_segment_ = 0;
+    }
+
+    // Detach() copies to the end of the scratch buffer, so the segments left
+    // are not in the order of their offsets.
+    for(i = first_segment_; i < segments_.size(); i++) {
+        if(segments_[i].address == nullptr && segments_[i].offset < live) live = segments_[i].offset;
+    }
+
+    if(live < COMPACT_BYTES || live * 2 < scratch_.Length()) return;
+
+    memmove(&scratch_[0], &scratch_[live], scratch_.Length() - live);
+    scratch_.Resize(scratch_.Length() - live);
+
+    for(i = first_segment_; i < segments_.size(); i++) {
+        if(segments_[i].address == nullptr) segments_[i].offset = segments_[i].offset - live;
+    }
+}
+
+const char* FrameWriter::SegmentAddress(const Segment& segment) const {
+    if(segment.address != nullptr) return segment.address;
+    return scratch_.Address(segment.offset);
+}
@@ -0,0 +1,79 @@
+#ifndef _LHTTP2_FRAME_WRITER_H_
+#define _LHTTP2_FRAME_WRITER_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "buffer/buffer.h"
+#include "hpack/hpack.h"
+#include "frame.h"
+
+namespace lhttp2 {
+    /*
+        ### Frame writer ###
+
+        FrameWriter collects frames as a list of segments and writes all of
+        them with gathering sendmsg() calls. Frame headers and small fixed
+        fields are copied into the writer, while DATA, HEADERS and
+        CONTINUATION payloads are referenced where they live, so body bytes
+        are never concatenated with their frame header.
+
+        A referenced payload belongs to its frame. The frame must outlive
+        the Flush() call that writes it, unless Detach() copied the payload
+        into the writer first. Payloads shorter than the copy threshold are
+        always copied, which lets a queue hold small frames past their
+        lifetime.
+
+        Written segments and the copies they held are dropped once they make
+        up most of the writer, so a queue that is never completely drained
+        still only keeps what it has left to write.
+    */
+    class FrameWriter {
+    public:
+        FrameWriter();
+        ~FrameWriter();
+
+        FrameWriter(const FrameWriter&) = delete;
+        FrameWriter& operator=(const FrameWriter&) = delete;
+
+        void Append(Frame* frame, hpack::Table& hpack_table);
+
+        void AppendCopy(const char* buff, const uint32_t len);
+        void AppendReference(const char* buff, const uint32_t len);
+        void AppendPadding(const uint32_t len);
+
+        int Flush(const int fd, const int flags = 0);
+        void Detach();
+        void Truncate(const uint32_t len);
+        void Clear();
+
+        bool Empty() const;
+        bool Borrowed() const;
+        const uint32_t Length() const;
+
+        const uint32_t copy_threshold() const;
+        void set_copy_threshold(uint32_t copy_threshold);
+
+        void Print() const;
+
+    private:
+        struct Segment {
+            const char* address;    // nullptr if the bytes live in scratch_
+            uint32_t offset;
+            uint32_t length;
+            bool borrowed;          // points into memory owned by a frame
+        };
+
+        const char* SegmentAddress(const Segment& segment) const;
+        void Compact();
+
+        std::vector<Segment> segments_;
+        size_t first_segment_ = 0;
+        uint32_t length_ = 0;
+        uint32_t borrowed_segments_ = 0;
+        uint32_t copy_threshold_ = 0;
+        Buffer scratch_;
+    };
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "block_decoder.h"
+
+using namespace hpack;
+
+BlockDecoder::BlockDecoder() {
+}
+
+// Starts a new header block, dropping what is left of the previous one.
+void BlockDecoder::Begin(uint32_t max_header_list_size) {
+    pending_.Clear();
+    in_block_ = true;
+    oversized_ = false;
+    refused_ = false;
+    header_list_size_ = 0;
+    max_header_list_size_ = max_header_list_size;
+}
+
+static Table::DECODE_STATUS DecodeField(Table& table, const BufferView& buff, uint32_t& offset, std::vector<HeaderFieldRepresentation>& header_list, uint32_t& field_size) {
+    HeaderFieldRepresentation header;
+    Table::DECODE_STATUS status = table.DecodeField(buff, offset, header, field_size);
+
+    if(status == Table::DECODE_FIELD) header_list.push_back(header);
+    return status;
+}
+
+static Table::DECODE_STATUS DecodeField(Table& table, const BufferView& buff, uint32_t& offset, HeaderList& header_list, uint32_t& field_size) {
+    return table.DecodeField(buff, offset, header_list, field_size);
+}
+
+bool BlockDecoder::Decode(Table& table, const BufferView& fragment, std::vector<HeaderFieldRepresentation>& header_list) {
+    return DecodeFragment(table, fragment, header_list);
+}
+
+bool BlockDecoder::Decode(Table& table, const BufferView& fragment, HeaderList& header_list) {
+    return DecodeFragment(table, fragment, header_list);
+}
+
+template<typename List>
+bool BlockDecoder::DecodeFragment(Table& table, const BufferView& fragment, List& header_list) {
+    uint32_t offset = 0, field_size;
+    Table::DECODE_STATUS status;
+    BufferView buff = fragment;
+    bool buffered = false;
+    Buffer rest;
+    List dropped;
+
+    if(in_block_ == false) return false;
+
+    // Only a field cut by the previous fragment is copied; the rest of the
+    // fragment is decoded where it is.
+    if(pending_.Length() > 0) {
+        pending_.Append(fragment);
+        buff = BufferView(pending_);
+        buffered = true;
+    }
+
+    while(offset < buff.Length()) {
+        status = DecodeField(table, buff, offset, oversized_ ? dropped : header_list, field_size);
+        if(status == Table::DECODE_ERROR) {
+            in_block_ = false;
+            return false;
+        }
+
+        if(status == Table::DECODE_INCOMPLETE) {
+            if(field_size > max_header_list_size_) {
+                in_block_ = false;
+                refused_ = true;
+                return false;
+            }
+            break;
+        }
+
+        if((uint64_t)header_list_size_ + field_size > max_header_list_size_) oversized_ = true;
+        else header_list_size_ = header_list_size_ + field_size;
+    }
+
+    if(buffered == true) {
+        rest.Copy(buff.Slice(offset));
+        pending_ = std::move(rest);
+    }
+    else {
+        pending_.Copy(buff.Slice(offset));
+    }
+
+    return true;
+}
+
+// Ends the block. Returns false if it stopped in the middle of a field.
+bool BlockDecoder::End() {
+    bool complete = in_block_ && pending_.Length() == 0;
+
+    pending_.Clear();
+    in_block_ = false;
+
+    return complete;
+}
+
+bool BlockDecoder::InBlock() const {
+    return in_block_;
+}
+
+// Whether the last block exceeded the maximum header list size, after which
+// its fields were decoded but not appended.
+bool BlockDecoder::Oversized() const {
+    return oversized_;
+}
+
+// Whether decoding stopped at a single field larger than the maximum.
+bool BlockDecoder::Refused() const {
+    return refused_;
+}
+
+uint32_t BlockDecoder::HeaderListSize() const {
+    return header_list_size_;
+}
+
+// Bytes of an incomplete field held until the next fragment.
+uint32_t BlockDecoder::Pending() const {
+    return pending_.Length();
+}
@@ -0,0 +1,60 @@
+#ifndef _HPACK_BLOCK_DECODER_H_
+#define _HPACK_BLOCK_DECODER_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "../buffer/buffer.h"
+#include "hpack.h"
+#include "header_list.h"
+
+namespace hpack {
+    /*
+        ### Block decoder ###
+        Resumable decoder for a header block that arrives in fragments, as
+        in a HEADERS or PUSH_PROMISE frame followed by CONTINUATION frames.
+
+        Fragments are fed in order with Decode(), which appends every field
+        completed so far and keeps only the bytes of the field still being
+        received. The fields' sizes are added up as RFC 7541, 4.1 counts
+        them. The maximum header list size is advisory, so a block that
+        exceeds it is still decoded to keep the table in step with the
+        peer's, but no field after the one that crosses it is appended, and
+        Oversized() tells the caller to discard the block's fields and
+        refuse its stream.
+
+        Only a field that exceeds the maximum by itself before it has all
+        arrived is refused, once its length prefix shows that, so no more
+        than that is ever buffered. Refused() is then set and, as after any
+        other failure, the decoder table is out of step with the peer's and
+        the connection has to end.
+    */
+    class BlockDecoder {
+    public:
+        BlockDecoder();
+
+        void Begin(uint32_t max_header_list_size = UINT32_MAX);
+        bool Decode(Table& table, const BufferView& fragment, std::vector<HeaderFieldRepresentation>& header_list);
+        bool Decode(Table& table, const BufferView& fragment, HeaderList& header_list);
+        bool End();
+
+        bool InBlock() const;
+        bool Oversized() const;
+        bool Refused() const;
+        uint32_t HeaderListSize() const;
+        uint32_t Pending() const;
+
+    private:
+        template<typename List>
+        bool DecodeFragment(Table& table, const BufferView& fragment, List& header_list);
+
+        Buffer pending_;
+        bool in_block_ = false;
+        bool oversized_ = false;
+        bool refused_ = false;
+        uint32_t header_list_size_ = 0;
+        uint32_t max_header_list_size_ = UINT32_MAX;
+    };
+}
+
+#endif
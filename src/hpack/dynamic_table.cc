@@ -0,0 +1,193 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "dynamic_table.h"
+
+using namespace hpack;
+
+#define ENTRIES_CAPACITY_MIN 16
+
+DynamicTable::DynamicTable(uint32_t max_size) : max_size_(max_size) {
+}
+
+DynamicTable::~DynamicTable() {
+    if(strings_ != nullptr) free(strings_);
+}
+
+// Adds a field as the newest entry, evicting the oldest ones until it fits.
+// A field larger than the whole table empties it and is not added (RFC 7541, 4.4).
+bool DynamicTable::Insert(const BufferView& name, const BufferView& value) {
+    uint32_t len = name.Length() + value.Length(), size = EntrySize(name.Length(), value.Length()), offset;
+    BufferView name_view = name, value_view = value;
+    Buffer copy;
+
+    // The name may refer to an entry that is about to be evicted and overwritten.
+    if(len > 0 && strings_ != nullptr && \
+        ((name.Length() > 0 && name.Address() >= strings_ && name.Address() < strings_ + strings_capacity_) || \
+         (value.Length() > 0 && value.Address() >= strings_ && value.Address() < strings_ + strings_capacity_))) {
+        copy.Append(name);
+        copy.Append(value);
+        name_view = BufferView(copy).Slice(0, name.Length());
+        value_view = BufferView(copy).Slice(name.Length());
+    }
+
+    while(count_ > 0 && size_ + size > max_size_) {
+        Evict();
+    }
+    if(size > max_size_) return false;
+
+    if(count_ == entries_.size()) {
+        std::vector<Entry> entries(entries_.empty() ? ENTRIES_CAPACITY_MIN : entries_.size() * 2);
+        for(uint32_t i = 0; i < count_; i++) {
+            entries[i] = At(count_ - 1 - i);
+        }
+        entries_.swap(entries);
+        entry_head_ = 0;
+    }
+
+    if(strings_capacity_ < 2 * max_size_) {
+        Relayout(2 * max_size_);
+    }
+    if(Place(len, offset) == false) {
+        Relayout(strings_capacity_);
+        Place(len, offset);
+    }
+
+    if(name_view.Length() > 0) memcpy(strings_ + offset, name_view.Address(), name_view.Length());
+    if(value_view.Length() > 0) memcpy(strings_ + offset + name_view.Length(), value_view.Address(), value_view.Length());
+
+    Entry& entry = entries_[(entry_head_ + count_) & (entries_.size() - 1)];
+    entry.offset = offset;
+    entry.name_len = name_view.Length();
+    entry.value_len = value_view.Length();
+
+    count_ = count_ + 1;
+    size_ = size_ + size;
+    inserted_ = inserted_ + 1;
+
+    return true;
+}
+
+// Removes the oldest entry.
+void DynamicTable::Evict() {
+    if(count_ == 0) return;
+
+    const Entry& entry = entries_[entry_head_];
+    size_ = size_ - EntrySize(entry.name_len, entry.value_len);
+    entry_head_ = (entry_head_ + 1) & (entries_.size() - 1);
+    count_ = count_ - 1;
+
+    if(count_ == 0) {
+        strings_head_ = 0;
+        strings_tail_ = 0;
+        strings_wrapped_ = false;
+        return;
+    }
+
+    // Once the entry that wrapped around is the oldest, the ring is in one piece again.
+    if(strings_wrapped_ && inserted_ - count_ == wrap_seq_) {
+        strings_wrapped_ = false;
+    }
+    strings_head_ = entries_[entry_head_].offset;
+}
+
+void DynamicTable::Clear() {
+    entry_head_ = 0;
+    count_ = 0;
+    size_ = 0;
+    strings_head_ = 0;
+    strings_tail_ = 0;
+    strings_wrapped_ = false;
+}
+
+// Evicts entries until the table fits. The string ring grows on the next insert.
+void DynamicTable::SetMaxSize(uint32_t max_size) {
+    max_size_ = max_size;
+    while(size_ > max_size_) {
+        Evict();
+    }
+}
+
+uint32_t DynamicTable::Count() const {
+    return count_;
+}
+
+uint32_t DynamicTable::Size() const {
+    return size_;
+}
+
+uint32_t DynamicTable::MaxSize() const {
+    return max_size_;
+}
+
+// Number of entries ever inserted. Entry i has sequence number Inserted() - 1 - i.
+uint64_t DynamicTable::Inserted() const {
+    return inserted_;
+}
+
+BufferView DynamicTable::Name(uint32_t i) const {
+    if(i >= count_) return BufferView();
+    const Entry& entry = At(i);
+    return BufferView(strings_ + entry.offset, entry.name_len);
+}
+
+BufferView DynamicTable::Value(uint32_t i) const {
+    if(i >= count_) return BufferView();
+    const Entry& entry = At(i);
+    return BufferView(strings_ + entry.offset + entry.name_len, entry.value_len);
+}
+
+uint32_t DynamicTable::EntrySize(uint32_t name_len, uint32_t value_len) {
+    return name_len + value_len + DYNAMIC_TABLE_ENTRY_OVERHEAD;
+}
+
+const DynamicTable::Entry& DynamicTable::At(uint32_t i) const {
+    return entries_[(entry_head_ + count_ - 1 - i) & (entries_.size() - 1)];
+}
+
+// Finds len contiguous free bytes in the string ring and claims them.
+bool DynamicTable::Place(uint32_t len, uint32_t& offset) {
+    if(strings_wrapped_ == false) {
+        if(len <= strings_capacity_ - strings_tail_) {
+            offset = strings_tail_;
+            strings_tail_ = strings_tail_ + len;
+            return true;
+        }
+        if(len <= strings_head_) {
+            offset = 0;
+            strings_tail_ = len;
+            strings_wrapped_ = true;
+            wrap_seq_ = inserted_;
+            return true;
+        }
+        return false;
+    }
+
+    if(len <= strings_head_ - strings_tail_) {
+        offset = strings_tail_;
+        strings_tail_ = strings_tail_ + len;
+        return true;
+    }
+    return false;
+}
+
+// Moves every string into a new ring of the given capacity, oldest first from its start.
+void DynamicTable::Relayout(uint32_t strings_capacity) {
+    char* strings = (char *)malloc(sizeof(char) * (strings_capacity > 0 ? strings_capacity : 1));
+    uint32_t at = 0, len;
+
+    for(uint32_t i = count_; i > 0; i--) {
+        Entry& entry = entries_[(entry_head_ + count_ - i) & (entries_.size() - 1)];
+        len = entry.name_len + entry.value_len;
+        if(len > 0) memcpy(strings + at, strings_ + entry.offset, len);
+        entry.offset = at;
+        at = at + len;
+    }
+
+    if(strings_ != nullptr) free(strings_);
+    strings_ = strings;
+    strings_capacity_ = strings_capacity;
+    strings_head_ = 0;
+    strings_tail_ = at;
+    strings_wrapped_ = false;
+}
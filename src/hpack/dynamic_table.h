@@ -0,0 +1,80 @@
+#ifndef _HPACK_DYNAMIC_TABLE_H_
+#define _HPACK_DYNAMIC_TABLE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "../buffer/buffer.h"
+
+// Every entry is accounted as its name and value plus 32 octets (RFC 7541, 4.1).
+#define DYNAMIC_TABLE_ENTRY_OVERHEAD 32
+
+namespace hpack {
+    /*
+        ### Dynamic table ###
+        FIFO of header fields bounded by the RFC 7541 size rule. Entries are
+        kept in a ring, so inserting the newest and evicting the oldest are
+        both O(1) and nothing is shifted.
+
+        Names and values are stored back to back in one byte ring of twice
+        the maximum table size, where every entry's strings are contiguous.
+        That is always enough room: an entry that does not fit before the end
+        of the ring starts over at its beginning, and the bytes it skips are
+        less than the table size.
+
+        Entry 0 is the newest. Views returned by Name() and Value() stay valid
+        until the entry is evicted.
+    */
+    class DynamicTable {
+    public:
+        DynamicTable(uint32_t max_size);
+        ~DynamicTable();
+
+        DynamicTable(const DynamicTable&) = delete;
+        DynamicTable& operator=(const DynamicTable&) = delete;
+
+        bool Insert(const BufferView& name, const BufferView& value);
+        void Evict();
+        void Clear();
+
+        void SetMaxSize(uint32_t max_size);
+
+        uint32_t Count() const;
+        uint32_t Size() const;
+        uint32_t MaxSize() const;
+        uint64_t Inserted() const;
+
+        BufferView Name(uint32_t i) const;
+        BufferView Value(uint32_t i) const;
+
+        static uint32_t EntrySize(uint32_t name_len, uint32_t value_len);
+
+    private:
+        struct Entry {
+            uint32_t offset;
+            uint32_t name_len;
+            uint32_t value_len;
+        };
+
+        const Entry& At(uint32_t i) const;
+        bool Place(uint32_t len, uint32_t& offset);
+        void Relayout(uint32_t strings_capacity);
+
+        std::vector<Entry> entries_;
+        uint32_t entry_head_ = 0;
+        uint32_t count_ = 0;
+
+        char* strings_ = nullptr;
+        uint32_t strings_capacity_ = 0;
+        uint32_t strings_head_ = 0;
+        uint32_t strings_tail_ = 0;
+        bool strings_wrapped_ = false;
+        uint64_t wrap_seq_ = 0;
+
+        uint32_t size_ = 0;
+        uint32_t max_size_;
+        uint64_t inserted_ = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef _HPACK_HASH_H_
+#define _HPACK_HASH_H_
+
+#include <stdint.h>
+
+#include "../buffer/buffer.h"
+
+// FNV-1a over the name, continued over the value for full field lookups.
+#define HASH_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define HASH_PRIME 0x100000001b3ULL
+
+namespace hpack {
+    inline uint64_t HashBytes(const BufferView& buff, uint64_t hash = HASH_OFFSET_BASIS) {
+        const char* address = buff.Address();
+        for(unsigned int i = 0; i < buff.Length(); i++) {
+            hash = (hash ^ (uint8_t)address[i]) * HASH_PRIME;
+        }
+        return hash;
+    }
+
+    inline uint64_t HashField(const uint64_t name_hash, const BufferView& value) {
+        return HashBytes(value, (name_hash ^ 0xFF) * HASH_PRIME);
+    }
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "header_list.h"
+#include "dynamic_table.h"
+
+using namespace hpack;
+
+HeaderList::HeaderList() {
+}
+
+HeaderList::~HeaderList() {
+    struct Block* block = first_block_, *next;
+
+    while(block != nullptr) {
+        next = block->next;
+        free(block);
+        block = next;
+    }
+
+    if(fields_ != inline_fields_) delete[] fields_;
+}
+
+// Adds a field whose strings are copied into the arena.
+void HeaderList::Append(HeaderField::HEADER_FIELD_TYPE type, const BufferView& name, const BufferView& value) {
+    BufferView name_copy = Store(name), value_copy = Store(value);
+    AppendReference(type, name_copy, value_copy);
+}
+
+// Adds a field referring to strings that outlive the list, such as those of the static table.
+void HeaderList::AppendReference(HeaderField::HEADER_FIELD_TYPE type, const BufferView& name, const BufferView& value) {
+    Field& field = NewField();
+
+    field.type = type;
+    field.name = name;
+    field.value = value;
+    size_ = size_ + DynamicTable::EntrySize(name.Length(), value.Length());
+}
+
+// Drops every field. The arena and the field array are kept for reuse.
+void HeaderList::Clear() {
+    for(struct Block* block = first_block_; block != nullptr; block = block->next) {
+        block->used = 0;
+    }
+    block_ = first_block_;
+    count_ = 0;
+    size_ = 0;
+}
+
+uint32_t HeaderList::Count() const {
+    return count_;
+}
+
+bool HeaderList::Empty() const {
+    return count_ == 0;
+}
+
+// Size of the list as SETTINGS_MAX_HEADER_LIST_SIZE counts it.
+uint32_t HeaderList::Size() const {
+    return size_;
+}
+
+const HeaderList::Field& HeaderList::operator[](const uint32_t i) const {
+    return fields_[i];
+}
+
+// Returns the value of the first field with the given name, or an empty view.
+BufferView HeaderList::Find(const BufferView& name) const {
+    for(uint32_t i = 0; i < count_; i++) {
+        if(fields_[i].name.Equals(name)) return fields_[i].value;
+    }
+    return BufferView();
+}
+
+// Returns len bytes of arena memory, starting a new block if the current one is full.
+char* HeaderList::Allocate(const uint32_t len) {
+    struct Block* block = block_;
+    uint32_t size;
+
+    while(block != nullptr && block->size - block->used < len) {
+        block = block->next;
+    }
+
+    if(block == nullptr) {
+        size = (len > HEADER_LIST_ARENA_BLOCK_SIZE) ? len : HEADER_LIST_ARENA_BLOCK_SIZE;
+        block = (struct Block *)malloc(sizeof(struct Block) + size);
+        block->next = nullptr;
+        block->size = size;
+        block->used = 0;
+
+        if(first_block_ == nullptr) first_block_ = block;
+        else {
+            struct Block* last = (block_ != nullptr) ? block_ : first_block_;
+            while(last->next != nullptr) last = last->next;
+            last->next = block;
+        }
+    }
+
+    block_ = block;
+    block->used = block->used + len;
+
+    return (char *)(block + 1) + block->used - len;
+}
+
+// Gives back the unused tail of the last allocation, e.g. after Huffman
+// decoding into room for the longest possible string.
+void HeaderList::Shrink(char* address, const uint32_t len, const uint32_t used_len) {
+    if(block_ == nullptr || used_len > len) return;
+    if((char *)(block_ + 1) + block_->used != address + len) return;
+    block_->used = block_->used - (len - used_len);
+}
+
+HeaderList::Field& HeaderList::NewField() {
+    if(count_ == capacity_) {
+        Field* fields = new Field[capacity_ * 2];
+        for(uint32_t i = 0; i < count_; i++) {
+            fields[i] = fields_[i];
+        }
+        if(fields_ != inline_fields_) delete[] fields_;
+        fields_ = fields;
+        capacity_ = capacity_ * 2;
+    }
+
+    return fields_[count_++];
+}
+
+BufferView HeaderList::Store(const BufferView& string) {
+    char* address;
+
+    if(string.Length() == 0) return BufferView();
+
+    address = Allocate(string.Length());
+    memcpy(address, string.Address(), string.Length());
+
+    return BufferView(address, string.Length());
+}
@@ -0,0 +1,77 @@
+#ifndef _HPACK_HEADER_LIST_H_
+#define _HPACK_HEADER_LIST_H_
+
+#include <stdint.h>
+
+#include "../buffer/buffer.h"
+#include "hpack.h"
+
+// Fields kept inside the list before it allocates an array for them.
+#define HEADER_LIST_INLINE_FIELDS 24
+
+// Size of the arena blocks holding the decoded strings.
+#define HEADER_LIST_ARENA_BLOCK_SIZE 4096
+
+namespace hpack {
+    /*
+        ### Header list ###
+        Decoded header list whose names and values are views instead of
+        strings. Strings that come out of the static table are referenced
+        where they are. Literals, Huffman decoded strings and entries of the
+        dynamic table, which a later field of the same block may evict, are
+        copied into an arena owned by the list.
+
+        The arena is a chain of blocks that never move, so views stay valid
+        until Clear() or the list is destroyed. The first fields are kept in
+        the list itself, so a typical request decodes into one allocation,
+        and a list that is cleared and reused keeps its memory and makes none.
+    */
+    class HeaderList {
+    public:
+        struct Field {
+            HeaderField::HEADER_FIELD_TYPE type;
+            BufferView name;
+            BufferView value;
+        };
+
+        HeaderList();
+        ~HeaderList();
+
+        HeaderList(const HeaderList&) = delete;
+        HeaderList& operator=(const HeaderList&) = delete;
+
+        void Append(HeaderField::HEADER_FIELD_TYPE type, const BufferView& name, const BufferView& value);
+        void AppendReference(HeaderField::HEADER_FIELD_TYPE type, const BufferView& name, const BufferView& value);
+        void Clear();
+
+        uint32_t Count() const;
+        bool Empty() const;
+        uint32_t Size() const;
+        const Field& operator[](const uint32_t i) const;
+        BufferView Find(const BufferView& name) const;
+
+        char* Allocate(const uint32_t len);
+        void Shrink(char* address, const uint32_t len, const uint32_t used_len);
+
+    private:
+        struct Block {
+            struct Block* next;
+            uint32_t size;
+            uint32_t used;
+        };
+
+        Field& NewField();
+        BufferView Store(const BufferView& string);
+
+        Field inline_fields_[HEADER_LIST_INLINE_FIELDS];
+        Field* fields_ = inline_fields_;
+        uint32_t count_ = 0;
+        uint32_t capacity_ = HEADER_LIST_INLINE_FIELDS;
+        uint32_t size_ = 0;
+
+        struct Block* first_block_ = nullptr;
+        struct Block* block_ = nullptr;
+    };
+}
+
+#endif
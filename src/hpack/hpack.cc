@@ -1,329 +1,926 @@
 #include <stdint.h>
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <chrono>
 #include <iostream>
+#include <unordered_map>
 
 #include "hpack.h"
 #include "huffman.h"
+#include "hash.h"
+#include "header_list.h"
+#include "indexing_policy.h"
+#include "validation.h"
 
 using namespace hpack;
 
-static const struct HeaderField static_table[STATIC_TABLE_SIZE] = {
-    {"", ""},                               // 0
-    {":authority", ""},                     // 1
-    {":method", "GET"},                     // 2
-    {":method", "POST"},                    // 3
-    {":path", "/"},                         // 4
-    {":path", "/index.html"},               // 5
-    {":scheme", "http"},                    // 6
-    {":scheme", "https"},                   // 7
-    {":status", "200"},                     // 8
-    {":status", "204"},                     // 9
-    {":status", "206"},                     // 10
-    {":status", "304"},                     // 11
-    {":status", "400"},                     // 12
-    {":status", "404"},                     // 13
-    {":status", "500"},                     // 14
-    {"accept-charset", ""},                 // 15
-    {"accept-encoding", "gzip, deflate"},   // 16
-    {"accept-language", ""},                // 17
-    {"accept-ranges", ""},                  // 18
-    {"accept", ""},                         // 19
-    {"access-control-allow-origin", ""},    // 20
-    {"age", ""},                            // 21
-    {"allow", ""},                          // 22
-    {"authorization", ""},                  // 23
-    {"cache-control", ""},                  // 24
-    {"content-disposition", ""},            // 25
-    {"content-encoding", ""},               // 26
-    {"content-language", ""},               // 27
-    {"content-length", ""},                 // 28
-    {"content-location", ""},               // 29
-    {"content-range", ""},                  // 30
-    {"content-type", ""},                   // 31
-    {"cookie", ""},                         // 32
-    {"date", ""},                           // 33
-    {"etag", ""},                           // 34
-    {"expect", ""},                         // 35
-    {"expires", ""},                        // 36
-    {"from", ""},                           // 37
-    {"host", ""},                           // 38
-    {"if-match", ""},                       // 39
-    {"if-modified-since", ""},              // 40
-    {"if-none-match", ""},                  // 41
-    {"if-range", ""},                       // 42
-    {"if-unmodified-since", ""},            // 43
-    {"last-modified", ""},                  // 44
-    {"link", ""},                           // 45
-    {"location", ""},                       // 46
-    {"max-forwards", ""},                   // 47
-    {"proxy-authenticate", ""},             // 48
-    {"proxy-authorization", ""},            // 49
-    {"range", ""},                          // 50
-    {"referer", ""},                        // 51
-    {"refresh", ""},                        // 52
-    {"retry-after", ""},                    // 53
-    {"server", ""},                         // 54
-    {"set-cookie", ""},                     // 55
-    {"strict-transport-security", ""},      // 56
-    {"transfer-encoding", ""},              // 57
-    {"user-agend", ""},                     // 58
-    {"vary", ""},                           // 59
-    {"via", ""},                            // 60
-    {"www-authenticate", ""},               // 61
+/*
+    Static table of RFC 7541, Appendix A. It is constant data, so it costs
+    nothing at startup and lookups never copy its strings.
+*/
+struct StaticEntry {
+    const char* name;
+    uint32_t name_len;
+    const char* value;
+    uint32_t value_len;
 };
 
+#define STATIC_ENTRY(name, value) {name, sizeof(name) - 1, value, sizeof(value) - 1}
+
+static constexpr struct StaticEntry static_table[STATIC_TABLE_SIZE] = {
+    STATIC_ENTRY("", ""),                           // 0
+    STATIC_ENTRY(":authority", ""),                 // 1
+    STATIC_ENTRY(":method", "GET"),                 // 2
+    STATIC_ENTRY(":method", "POST"),                // 3
+    STATIC_ENTRY(":path", "/"),                     // 4
+    STATIC_ENTRY(":path", "/index.html"),           // 5
+    STATIC_ENTRY(":scheme", "http"),                // 6
+    STATIC_ENTRY(":scheme", "https"),               // 7
+    STATIC_ENTRY(":status", "200"),                 // 8
+    STATIC_ENTRY(":status", "204"),                 // 9
+    STATIC_ENTRY(":status", "206"),                 // 10
+    STATIC_ENTRY(":status", "304"),                 // 11
+    STATIC_ENTRY(":status", "400"),                 // 12
+    STATIC_ENTRY(":status", "404"),                 // 13
+    STATIC_ENTRY(":status", "500"),                 // 14
+    STATIC_ENTRY("accept-charset", ""),             // 15
+    STATIC_ENTRY("accept-encoding", "gzip, deflate"),// 16
+    STATIC_ENTRY("accept-language", ""),            // 17
+    STATIC_ENTRY("accept-ranges", ""),              // 18
+    STATIC_ENTRY("accept", ""),                     // 19
+    STATIC_ENTRY("access-control-allow-origin", ""),// 20
+    STATIC_ENTRY("age", ""),                        // 21
+    STATIC_ENTRY("allow", ""),                      // 22
+    STATIC_ENTRY("authorization", ""),              // 23
+    STATIC_ENTRY("cache-control", ""),              // 24
+    STATIC_ENTRY("content-disposition", ""),        // 25
+    STATIC_ENTRY("content-encoding", ""),           // 26
+    STATIC_ENTRY("content-language", ""),           // 27
+    STATIC_ENTRY("content-length", ""),             // 28
+    STATIC_ENTRY("content-location", ""),           // 29
+    STATIC_ENTRY("content-range", ""),              // 30
+    STATIC_ENTRY("content-type", ""),               // 31
+    STATIC_ENTRY("cookie", ""),                     // 32
+    STATIC_ENTRY("date", ""),                       // 33
+    STATIC_ENTRY("etag", ""),                       // 34
+    STATIC_ENTRY("expect", ""),                     // 35
+    STATIC_ENTRY("expires", ""),                    // 36
+    STATIC_ENTRY("from", ""),                       // 37
+    STATIC_ENTRY("host", ""),                       // 38
+    STATIC_ENTRY("if-match", ""),                   // 39
+    STATIC_ENTRY("if-modified-since", ""),          // 40
+    STATIC_ENTRY("if-none-match", ""),              // 41
+    STATIC_ENTRY("if-range", ""),                   // 42
+    STATIC_ENTRY("if-unmodified-since", ""),        // 43
+    STATIC_ENTRY("last-modified", ""),              // 44
+    STATIC_ENTRY("link", ""),                       // 45
+    STATIC_ENTRY("location", ""),                   // 46
+    STATIC_ENTRY("max-forwards", ""),               // 47
+    STATIC_ENTRY("proxy-authenticate", ""),         // 48
+    STATIC_ENTRY("proxy-authorization", ""),        // 49
+    STATIC_ENTRY("range", ""),                      // 50
+    STATIC_ENTRY("referer", ""),                    // 51
+    STATIC_ENTRY("refresh", ""),                    // 52
+    STATIC_ENTRY("retry-after", ""),                // 53
+    STATIC_ENTRY("server", ""),                     // 54
+    STATIC_ENTRY("set-cookie", ""),                 // 55
+    STATIC_ENTRY("strict-transport-security", ""),  // 56
+    STATIC_ENTRY("transfer-encoding", ""),          // 57
+    STATIC_ENTRY("user-agent", ""),                 // 58
+    STATIC_ENTRY("vary", ""),                       // 59
+    STATIC_ENTRY("via", ""),                        // 60
+    STATIC_ENTRY("www-authenticate", ""),           // 61
+};
+
+/*
+    Implementation of HeaderField
+*/
+
+HeaderField::HeaderField() : name_use_huffman_(false), value_use_huffman_(false) {
+}
+
+HeaderField::HeaderField(std::string name, std::string value) : name_use_huffman_(false), value_use_huffman_(false), name_(name), value_(value) {
+}
+
+HeaderField::HeaderField(bool name_use_huffman, bool value_use_huffman, std::string name, std::string value) : name_use_huffman_(name_use_huffman), value_use_huffman_(value_use_huffman), name_(name), value_(value) {
+}
+
+bool HeaderField::NameUseHuffman() const {
+    return name_use_huffman_;
+}
+
+bool HeaderField::ValueUseHuffman() const {
+    return value_use_huffman_;
+}
+
+bool HeaderField::SetNameUseHuffman(bool use) {
+    name_use_huffman_ = use;
+    return name_use_huffman_;
+}
+
+bool HeaderField::SetValueUseHuffman(bool use) {
+    value_use_huffman_ = use;
+    return value_use_huffman_;
+}
+
+const std::string& HeaderField::Name() const {
+    return name_;
+}
+
+const std::string& HeaderField::Value() const {
+    return value_;
+}
+
+void HeaderField::SetName(const std::string name) {
+    name_ = name;
+}
+
+void HeaderField::SetValue(const std::string value) {
+    value_ = value;
+}
+
+void HeaderField::SetName(const BufferView& name) {
+    name_.assign(name.Length() > 0 ? name.Address() : "", name.Length());
+}
+
+void HeaderField::SetValue(const BufferView& value) {
+    value_.assign(value.Length() > 0 ? value.Address() : "", value.Length());
+}
+
+/*
+    Implementation of HeaderFieldRepresentation
+*/
+
+HeaderField& HeaderFieldRepresentation::Field() {
+    return header_field_;
+}
+
+HeaderField::HEADER_FIELD_TYPE& HeaderFieldRepresentation::Type() {
+    return type_;
+}
+
+const HeaderField& HeaderFieldRepresentation::Field() const {
+    return header_field_;
+}
+
+HeaderField::HEADER_FIELD_TYPE HeaderFieldRepresentation::Type() const {
+    return type_;
+}
+
+/*
+    Implementation of BlockCache
+*/
+
+static bool SameHeaderList(const std::vector<HeaderFieldRepresentation>& a, const HeaderFieldRepresentation* b, const size_t count) {
+    if(a.size() != count) return false;
+
+    for(size_t i = 0; i < count; i++) {
+        if(a[i].Type() != b[i].Type()) return false;
+        if(a[i].Field().NameUseHuffman() != b[i].Field().NameUseHuffman()) return false;
+        if(a[i].Field().ValueUseHuffman() != b[i].Field().ValueUseHuffman()) return false;
+        if(a[i].Field().Name() != b[i].Field().Name()) return false;
+        if(a[i].Field().Value() != b[i].Field().Value()) return false;
+    }
+
+    return true;
+}
+
+BlockCache::BlockCache() : entries_(HEADER_BLOCK_CACHE_SLOTS) {
+}
+
+// Returns the block encoded for the list at this generation, or nullptr if
+// there is none or it cannot be reused with the given update mode.
+const Buffer* BlockCache::Find(const uint64_t key, const HeaderFieldRepresentation* headers, const size_t count, const uint64_t generation, const bool update) {
+    const Entry& entry = entries_[key % entries_.size()];
+
+    if(entry.valid == false || entry.key != key || entry.generation != generation || \
+        (update == true && entry.inserts == true) || SameHeaderList(entry.header_list, headers, count) == false) {
+        misses_ = misses_ + 1;
+        return nullptr;
+    }
+
+    hits_ = hits_ + 1;
+    return &entry.block;
+}
+
+void BlockCache::Store(const uint64_t key, const HeaderFieldRepresentation* headers, const size_t count, const uint64_t generation, const bool inserts, const BufferView& block) {
+    Entry& entry = entries_[key % entries_.size()];
+
+    entry.valid = true;
+    entry.inserts = inserts;
+    entry.key = key;
+    entry.generation = generation;
+    entry.header_list.assign(headers, headers + count);
+    entry.block.Clear();
+    entry.block.Append(block);
+}
+
+void BlockCache::Clear() {
+    for(size_t i = 0; i < entries_.size(); i++) {
+        entries_[i].valid = false;
+        entries_[i].header_list.clear();
+        entries_[i].block.Clear();
+    }
+}
+
+uint64_t BlockCache::Hits() const {
+    return hits_;
+}
+
+uint64_t BlockCache::Misses() const {
+    return misses_;
+}
+
+/*
+    Implementation of Table
+*/
+
 static const uint8_t prefix_max[] = {0, 1, 3, 7, 15, 31, 63, 127, 255};
 
+// Appends an integer with the given prefix length (RFC 7541, 5.1). The
+// bits of prefix_dummy above the prefix are the representation's pattern.
 static void EncodeInteger(Buffer& buff, uint32_t i, uint8_t prefix_length, uint8_t prefix_dummy) {
-    if(prefix_length <= 0 || prefix_length > 8) {
-        buff.Clear();
+    uint32_t at = buff.Length(), len = 1, rest;
+
+    if(prefix_length <= 0 || prefix_length > 8) return;
+
+    if(i < prefix_max[prefix_length]) {
+        buff.Append((char)((prefix_dummy & ~prefix_max[prefix_length]) | i));
         return;
     }
 
-    if(i < prefix_max[prefix_length]) {
-        buff.Resize(1);
-        buff.Set((prefix_dummy & ~prefix_max[prefix_length]) | i, 0);
+    i = i - prefix_max[prefix_length];
+    for(rest = i; rest >= 128; rest = rest >> 7) len++;
+    buff.Resize(at + 1 + len);
+    buff[at++] = (char)((prefix_dummy & ~prefix_max[prefix_length]) | prefix_max[prefix_length]);
+    while(i >= 128) {
+        buff[at++] = (char)(i % 128 + 128);
+        i = i / 128;
     }
-    else {
-        int idx = 1;
-        buff.Resize(2 + (i - prefix_max[prefix_length]) / 128);
-        buff.Set((prefix_dummy & ~prefix_max[prefix_length]) | prefix_max[prefix_length], 0);
-        i = i - prefix_max[prefix_length];
-        while(i >= 128) {
-            buff.Set(i % 128 + 128, idx++);
-            i = i / 128;
-        }
-        buff.Set(i, idx);
+    buff[at] = (char)i;
+}
+
+// Decides whether a string literal is Huffman coded. If it is, huffman_len
+// is set to its encoded length.
+static bool ChooseHuffman(const BufferView& string, bool field_huffman, Table::HUFFMAN_MODE mode, uint32_t& huffman_len) {
+    switch(mode) {
+        case Table::HUFFMAN_NEVER:
+            return false;
+        case Table::HUFFMAN_ALWAYS:
+            break;
+        case Table::HUFFMAN_ADAPTIVE:
+            huffman_len = Huffman::EncodedLength(string);
+            return huffman_len < string.Length();
+        case Table::HUFFMAN_LATENCY:
+            if(string.Length() >= HUFFMAN_LATENCY_LENGTH && \
+                Huffman::EncodedLength(string.Slice(0, HUFFMAN_LATENCY_SAMPLE)) * 4 > HUFFMAN_LATENCY_SAMPLE * 3) {
+                return false;
+            }
+            huffman_len = Huffman::EncodedLength(string);
+            return huffman_len < string.Length();
+        default:
+            if(field_huffman == false) return false;
+            break;
+    }
+
+    huffman_len = Huffman::EncodedLength(string);
+    return true;
+}
+
+// Appends a string literal (RFC 7541, 5.2). The Huffman coded length is
+// known before encoding, so the string is written straight into buff.
+// Huffman coded strings are counted in stats unless it is nullptr.
+static void EncodeString(Buffer& buff, const BufferView& string, bool field_huffman, Table::HUFFMAN_MODE mode, TableStats* stats) {
+    uint32_t huffman_len, len, at;
+    bool huffman = ChooseHuffman(string, field_huffman, mode, huffman_len);
+
+    len = (huffman == true) ? huffman_len : string.Length();
+
+    if(huffman == true && stats != nullptr) {
+        stats->huffman_strings = stats->huffman_strings + 1;
+        stats->huffman_saved_bytes = stats->huffman_saved_bytes + (int64_t)string.Length() - len;
     }
+
+    EncodeInteger(buff, len, 7, (huffman == true) ? 0x80 : 0);
+
+    at = buff.Length();
+    buff.Resize(at + len);
+    if(len == 0) return;
+
+    if(huffman == true) Huffman::Encode(&buff[at], string);
+    else memcpy(&buff[at], string.Address(), len);
 }
 
-static uint32_t DecodeInteger(const Buffer& buff, uint32_t& offset, uint8_t prefix_length) {
+// Reads an integer with the given prefix length (RFC 7541, 5.1) and moves
+// offset past it. Returns 1, or 0 if buff ends inside the integer, or -1 if
+// it does not fit in 32 bits.
+static int DecodeInteger(const BufferView& buff, uint32_t& offset, uint8_t prefix_length, uint32_t& value) {
+    const uint8_t *p, *end, *limit;
+    uint32_t shift = 0;
+    uint64_t i;
+    uint8_t byte;
+
     if(prefix_length <= 0 || prefix_length > 8) {
+        return -1;
+    }
+    if(offset >= buff.Length()) {
         return 0;
     }
 
-    uint32_t i = buff.Get(offset++) & prefix_max[prefix_length];
+    p = (const uint8_t*)buff.Address() + offset;
+    end = (const uint8_t*)buff.Address() + buff.Length();
+    i = *p++ & prefix_max[prefix_length];
 
+    // Bounds are checked once: a 32 bit integer has at most five
+    // continuation bytes, so the loop stops at whichever comes first.
     if(i >= prefix_max[prefix_length]) {
-        uint32_t p = 1;
+        limit = (end - p > 5) ? p + 5 : end;
         do {
-            if(offset >= buff.Length()) {
-                return 0;
+            if(p == limit) {
+                return (shift < 35) ? 0 : -1;
             }
-            i = i + (buff.Get(offset & 127)) * p;
-            p = p * 128;
-        } while((buff.Get(offset++) & 128) == 128);
+            byte = *p++;
+            i = i + ((uint64_t)(byte & 127) << shift);
+            shift = shift + 7;
+        } while((byte & 128) == 128);
+
+        if(i > UINT32_MAX) {
+            return -1;
+        }
     }
 
-    return i;
+    value = (uint32_t)i;
+    offset = (uint32_t)(p - (const uint8_t*)buff.Address());
+    return 1;
+}
+
+// Reads the length prefix of a string literal (RFC 7541, 5.2).
+static int DecodeStringLength(const BufferView& buff, uint32_t& offset, uint32_t& len, bool& huffman) {
+    if(offset >= buff.Length()) return 0;
+    huffman = (buff.Get(offset) & 0x80) == 0x80;
+    return DecodeInteger(buff, offset, 7, len);
+}
+
+// No code is longer than 30 bits, so a Huffman string of len octets decodes
+// to at least len * 8 / 30 octets.
+static uint32_t LeastDecodedLength(const uint32_t len, const bool huffman) {
+    return (huffman == true) ? (uint32_t)((uint64_t)len * 8 / 30) : len;
+}
+
+static BufferView View(const std::string& str) {
+    return BufferView(str.data(), str.length());
+}
+
+/*
+    Perfect hashes of the static table. A name or name and value hashed as
+    for the dynamic index lands in slot (hash * multiplier) >> 56, which
+    holds the only static entry that can match it, or 0. Names map to their
+    lowest index, so ":method" resolves to 2 like a linear scan would.
+
+    The multipliers were found by trying random odd constants until no two
+    names, and no two names and values, shared a slot. The slots have to be
+    generated again if the table or HashBytes() ever change.
+*/
+#define STATIC_NAME_MULTIPLIER 0x3898d190f9ebdacdULL
+#define STATIC_FIELD_MULTIPLIER 0x13a5397f61ef7bd1ULL
+
+static constexpr uint8_t static_name_slots[256] = {
+     0,  0,  0,  0, 34, 26,  0,  0,  0,  0,  0, 47,  0, 53,  0, 58,
+     0,  0,  0,  0,  0, 19,  0, 41,  0,  0, 39,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 35,  0,  0,
+     0,  0,  0,  0, 55,  0,  0, 48, 52,  0,  0, 46,  0, 22,  0,  0,
+     0,  0,  0,  0, 49,  0,  0,  0,  0, 18,  0, 57, 50,  0,  0,  0,
+     0,  0,  0, 23,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0, 16,  0, 32,  0,  0,  0,  0, 28, 56,  0,
+    42,  0,  0, 30,  0, 40,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0, 29, 43,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0, 51,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0, 24,  0,  0,  0,  0,  0, 59, 33,  0, 54,
+     0, 61,  0, 21,  0,  0, 15, 38,  0,  0,  0, 44, 20,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0, 36,  6,  0,  0,  0,  0, 25,  0,
+     0,  0, 17,  0,  0, 37,  0,  0,  0, 45,  0,  0,  0,  0,  0,  0,
+     0, 27,  0,  0,  0,  0,  0,  0,  0,  0, 60,  0,  8,  0,  0,  0,
+     0,  0,  0,  2,  0, 31,  0,  1,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+static constexpr uint8_t static_field_slots[256] = {
+     0,  0,  0,  0,  0,  0,  0, 49, 41,  0, 40,  0, 55,  0,  0,  0,
+     3,  0,  0, 22,  0,  0, 53,  0,  0, 60, 24,  0,  0,  0,  0, 12,
+     0,  0,  0,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    26,  0,  0,  0, 18,  0,  5,  0,  0,  6,  0,  0,  0,  0,  0, 19,
+     0, 47,  0,  0,  0,  0,  0, 45,  0,  0,  8, 20,  0,  0,  0,  0,
+     0,  0,  0,  0, 23,  0,  0,  0,  0,  0,  0,  0,  0, 15,  0,  0,
+     0,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 34,
+     0,  0,  0,  0,  0, 51,  0,  0, 42,  0,  0, 25,  0,  4, 31,  0,
+     0, 57,  0,  0,  0,  0,  0, 28,  0, 56, 16,  0,  7,  0, 54,  9,
+     0,  0,  0, 44,  0,  0,  0,  0,  0,  0, 46,  0,  0,  0,  0,  0,
+     0, 37, 39, 36,  0,  0, 32,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0, 50,  0,  0,  0,  0, 21,  0, 29,  0,
+     0, 59,  0,  0,  0,  0, 14,  0,  0, 48, 33,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0, 43, 17,  0, 13,  0, 61, 58, 38,  0,
+     0,  0,  0,  0,  0,  0,  0, 35,  0,  0,  0,  0, 10,  0,  0,  0,
+     0,  0, 27,  0,  0,  0,  0,  0,  0,  0, 11, 30,  0,  0, 52,  0,
+};
+
+static BufferView StaticName(const uint32_t idx) {
+    return BufferView(static_table[idx].name, static_table[idx].name_len);
+}
+
+static BufferView StaticValue(const uint32_t idx) {
+    return BufferView(static_table[idx].value, static_table[idx].value_len);
+}
+
+static uint32_t StaticNameIndex(const uint64_t name_hash, const BufferView& name) {
+    uint32_t idx = static_name_slots[(name_hash * STATIC_NAME_MULTIPLIER) >> 56];
+    if(idx == 0 || StaticName(idx).Equals(name) == false) return 0;
+    return idx;
+}
+
+static uint32_t StaticFieldIndex(const uint64_t field_hash, const BufferView& name, const BufferView& value) {
+    uint32_t idx = static_field_slots[(field_hash * STATIC_FIELD_MULTIPLIER) >> 56];
+    if(idx == 0 || StaticName(idx).Equals(name) == false || StaticValue(idx).Equals(value) == false) return 0;
+    return idx;
 }
 
-static void AppendToTable(std::vector<HeaderField>& dynamic_table, uint32_t dynamic_table_size_max, HeaderField header) {
-    std::vector<HeaderField>::iterator it;
-    it = dynamic_table.begin();
-    dynamic_table.insert(it, header);
-    
-    while(dynamic_table.size() > dynamic_table_size_max) {
-        dynamic_table.pop_back();
+/*
+    Implementation of Dictionary
+*/
+
+Dictionary::Dictionary() {
+}
+
+// Adds a field, unless it is in the dictionary or the static table already.
+// Its name is referenced if the static table has it, as the dynamic table of
+// the encoder that sends the field may have changed by then.
+bool Dictionary::Add(const std::string& name, const std::string& value) {
+    uint64_t name_hash = HashBytes(View(name)), field_hash = HashField(name_hash, View(value));
+    uint32_t idx;
+    Entry entry;
+
+    if(StaticFieldIndex(field_hash, View(name), View(value)) != 0 || Find(View(name), View(value)) != nullptr) return false;
+
+    idx = StaticNameIndex(name_hash, View(name));
+    if(idx != 0) {
+        EncodeInteger(entry.encoded, idx, 6, 0x40);
+    }
+    else {
+        entry.encoded.Append((char)0x40);
+        EncodeString(entry.encoded, View(name), false, Table::HUFFMAN_ADAPTIVE, nullptr);
     }
+    EncodeString(entry.encoded, View(value), false, Table::HUFFMAN_ADAPTIVE, nullptr);
+
+    entry.name = name;
+    entry.value = value;
+    index_[field_hash] = entries_.size();
+    entries_.push_back(std::move(entry));
+    return true;
 }
 
-static uint32_t FindFromTable(std::vector<HeaderField>& dynamic_table, std::string name, std::string value) {
-    uint32_t i, total_size = STATIC_TABLE_SIZE + dynamic_table.size();
-    bool compare_value = false;
-    HeaderField header;
+// Returns the encoded field, or nullptr if the field is not in the dictionary.
+const Buffer* Dictionary::Find(const BufferView& name, const BufferView& value) const {
+    std::unordered_map<uint64_t, uint32_t>::const_iterator it = index_.find(HashField(HashBytes(name), value));
 
-    if(value.compare("") != 0)
-        compare_value = true;
+    if(it == index_.end()) return nullptr;
 
-    for(i = 1; i < total_size; i++) {
-        if(i < STATIC_TABLE_SIZE) header = static_table[i];
-        else header = dynamic_table[i - STATIC_TABLE_SIZE];
-        if(header.Name().compare(name) == 0) {
-            if(compare_value == false || (compare_value == true && header.Value().compare(value) == 0)) {
-                return i;
-            }
+    const Entry& entry = entries_[it->second];
+    if(View(entry.name).Equals(name) == false || View(entry.value).Equals(value) == false) return nullptr;
+    return &entry.encoded;
+}
+
+uint32_t Dictionary::Count() const {
+    return entries_.size();
+}
+
+Table::Table() : dynamic_table_(DYNAMIC_TABLE_SIZE_MAX) {
+}
+
+Table::Table(uint32_t dynamic_table_size_max) : dynamic_table_(dynamic_table_size_max) {
+}
+
+static uint64_t HashHeaderList(const HeaderFieldRepresentation* headers, const size_t count) {
+    uint64_t hash = HASH_OFFSET_BASIS;
+    char flags;
+
+    for(size_t i = 0; i < count; i++) {
+        const HeaderField& field = headers[i].Field();
+        flags = (char)((headers[i].Type() << 2) | (field.NameUseHuffman() << 1) | field.ValueUseHuffman());
+        hash = HashBytes(BufferView(&flags, 1), hash);
+        hash = HashField(HashBytes(View(field.Name()), hash), View(field.Value()));
+    }
+
+    return hash;
+}
+
+// Replaces the contents of encoded_buffer with the block. Integers and
+// strings are written in place, so a caller that keeps its buffer encodes
+// without allocating.
+bool Table::Encode(Buffer& encoded_buffer, const std::vector<HeaderFieldRepresentation>& header_list, bool update) {
+    encoded_buffer.Clear();
+    return Encode(encoded_buffer, header_list.data(), header_list.size(), update);
+}
+
+// Appends the block to out, so a caller can reuse one buffer for every
+// block it sends or encode straight behind a frame header.
+bool Table::Encode(Buffer& out, const HeaderFieldRepresentation* headers, const size_t count, bool update) {
+    uint32_t at = out.Length(), block_at;
+    uint64_t key = 0, generation = generation_;
+    const Buffer* block = nullptr;
+    bool inserts, use_block_cache = use_block_cache_;
+    bool count_stats = (use_stats_ == true && update == true);
+    std::chrono::steady_clock::time_point start;
+
+    // Blocks encoded only to be measured are not what the peer receives.
+    if(count_stats == true) start = std::chrono::steady_clock::now();
+
+    // Size updates come first in the block and are not part of what is cached.
+    if(size_update_pending_ == true) EncodeSizeUpdate(out);
+    block_at = out.Length();
+
+    // A policy with state may encode the same list differently next time.
+    if(indexing_policy_ != nullptr && indexing_policy_->Stateless() == false) use_block_cache = false;
+
+    if(use_block_cache == true) {
+        key = HashHeaderList(headers, count);
+        block = block_cache_.Find(key, headers, count, generation_, update);
+        if(block != nullptr) out.Append(*block);
+    }
+
+    if(block == nullptr && EncodeBlock(out, headers, count, update, inserts) == false) {
+        out.Resize(at);
+        return false;
+    }
+
+    if(count_stats == true) {
+        stats_.blocks = stats_.blocks + 1;
+        if(block != nullptr) stats_.cached_blocks = stats_.cached_blocks + 1;
+        for(size_t i = 0; i < count; i++) {
+            stats_.raw_bytes = stats_.raw_bytes + headers[i].Field().Name().length() + headers[i].Field().Value().length();
         }
+        if(size_update_pending_ == true) {
+            stats_.size_updates = stats_.size_updates + ((size_update_min_ < dynamic_table_.MaxSize()) ? 2 : 1);
+        }
+        stats_.encoded_bytes = stats_.encoded_bytes + out.Length() - at;
+        stats_.encode_nanoseconds = stats_.encode_nanoseconds + \
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
     }
+    // A block that is only measured leaves the update for the one that is sent.
+    if(update == true) size_update_pending_ = false;
+    if(block != nullptr) return true;
 
-    return 0;
+    // A block that changed the table belongs to a generation that is gone.
+    if(use_block_cache == true && (update == false || inserts == false)) {
+        block_cache_.Store(key, headers, count, generation, inserts, BufferView(out).Slice(block_at, out.Length() - block_at));
+    }
+
+    return true;
 }
 
-bool Table::Encode(Buffer& encoded_buffer, std::vector<HeaderFieldRepresentation> header_list, bool update) {
+// Appends the Dynamic Table Size Updates (RFC 7541, 6.3) owed to the peer.
+void Table::EncodeSizeUpdate(Buffer& out) {
+    if(size_update_min_ < dynamic_table_.MaxSize()) EncodeInteger(out, size_update_min_, 5, 0x20);
+    EncodeInteger(out, dynamic_table_.MaxSize(), 5, 0x20);
+}
+
+// Appends the encoded headers, setting inserts if the block adds fields to
+// the peer's table and so to this one when update is set.
+bool Table::EncodeBlock(Buffer& out, const HeaderFieldRepresentation* headers, const size_t count, bool update, bool& inserts) {
     uint32_t idx;
-    Buffer encode_int, huff;
-    std::vector<HeaderFieldRepresentation>::iterator it = header_list.begin();
-    std::vector<HeaderField>& update_table = dynamic_table_;
+    bool value_matched;
+    HeaderField::HEADER_FIELD_TYPE type;
+    const HeaderFieldRepresentation* it = headers;
+    const Buffer* encoded;
+    TableStats* stats = (use_stats_ == true && update == true) ? &stats_ : nullptr;
 
-    if(update == false) {
-        std::vector<HeaderField> temp_table = dynamic_table_;
-        update_table = temp_table;
-    }
+    inserts = false;
 
-    encoded_buffer.Clear();
+    for(; it != headers + count; it++) {
+        type = it->Type();
+        idx = Find(View(it->Field().Name()), View(it->Field().Value()), value_matched);
+        if(indexing_policy_ != nullptr) {
+            type = indexing_policy_->Decide(View(it->Field().Name()), View(it->Field().Value()), type, value_matched, update);
+        }
 
-    for(; it != header_list.end(); it++) {
-        if(it->Type() == HeaderField::INDEXED_HEADER_FIELD) {
-            idx = Find(it->Field().Name(), it->Field().Value());
-            if(idx == 0) {
-                it->Type() = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
-                it--;
+        if(stats != nullptr) {
+            stats->fields = stats->fields + 1;
+            if(idx == 0) stats->name_literals = stats->name_literals + 1;
+            else if(idx < STATIC_TABLE_SIZE) stats->static_hits = stats->static_hits + 1;
+            else stats->dynamic_hits = stats->dynamic_hits + 1;
+        }
+
+        // A field that is already in the table is sent as an index. Fields
+        // that must be indexed but are not in the table yet are added to it.
+        if(value_matched == true && type != HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING && type != HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED) {
+            EncodeInteger(out, idx, 7, 0x80);
+            if(stats != nullptr) stats->indexed_fields = stats->indexed_fields + 1;
+            continue;
+        }
+        if(stats != nullptr) stats->literal_fields = stats->literal_fields + 1;
+
+        // Dictionary fields are sent as encoded once for every connection,
+        // which is only what this table would send in the adaptive mode.
+        if(dictionary_ != nullptr && type != HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED) {
+            encoded = dictionary_->Find(View(it->Field().Name()), View(it->Field().Value()));
+            if(encoded != nullptr && huffman_mode_ == HUFFMAN_ADAPTIVE) {
+                out.Append(*encoded);
+                inserts = true;
+                if(update == true) Append(it->Field());
                 continue;
             }
-            EncodeInteger(encode_int, idx, 7, 0x80);
-            encoded_buffer.Append(encode_int);
+            if(encoded != nullptr) type = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
+        }
+        if(type == HeaderField::INDEXED_HEADER_FIELD) {
+            type = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
         }
-        else {
-            idx = Find(it->Field().Name(), "");
-            if(idx == 0) {
-                if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING)
-                    encoded_buffer.Append(0x40);
-                else if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING)
-                    encoded_buffer.Append(0x00);
-                else if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED)
-                    encoded_buffer.Append(0x10);
-                
-                if(it->Field().NameUseHuffman() == true) {
-                    Huffman::GetInstance().Encode(huff, it->Field().Name().length());
-                    EncodeInteger(encode_int, huff.Length(), 7, 0x80);
-                    encoded_buffer.Append(encode_int);
-                    encoded_buffer.Append(huff);
-                }
-                else {
-                    EncodeInteger(encode_int, it->Field().Name().length(), 7, 0);
-                    encoded_buffer.Append(encode_int);
-                    encoded_buffer.Append(it->Field().Name().c_str());
-                }
-            } else {
-                if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING)
-                    EncodeInteger(encode_int, idx, 6, 0x40);
-                else if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING)
-                    EncodeInteger(encode_int, idx, 4, 0x00);
-                else if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED)
-                    EncodeInteger(encode_int, idx, 4, 0x10);
-                encoded_buffer.Append(encode_int);
-            }
 
-            if(it->Field().ValueUseHuffman() == true) {
-                Huffman::GetInstance().Encode(huff, it->Field().Value().length());
-                EncodeInteger(encode_int, huff.Length(), 7, 0x80);
-                encoded_buffer.Append(encode_int);
-                encoded_buffer.Append(huff);
-            }
-            else {
-                EncodeInteger(encode_int, it->Field().Value().length(), 7, 0);
-                encoded_buffer.Append(encode_int);
-                encoded_buffer.Append(it->Field().Value().c_str());
-            }
+        if(idx == 0) {
+            if(type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING)
+                out.Append((char)0x40);
+            else if(type == HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING)
+                out.Append((char)0x00);
+            else if(type == HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED)
+                out.Append((char)0x10);
+
+            EncodeString(out, View(it->Field().Name()), it->Field().NameUseHuffman(), huffman_mode_, stats);
+        } else {
+            if(type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING)
+                EncodeInteger(out, idx, 6, 0x40);
+            else if(type == HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING)
+                EncodeInteger(out, idx, 4, 0x00);
+            else if(type == HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED)
+                EncodeInteger(out, idx, 4, 0x10);
+        }
+
+        EncodeString(out, View(it->Field().Value()), it->Field().ValueUseHuffman(), huffman_mode_, stats);
+
+        // The peer's decoder adds the field to its table, so ours must too.
+        if(type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING) {
+            inserts = true;
+            if(update == true) Append(it->Field());
         }
     }
 
     return true;
 }
 
-bool Table::Decode(std::vector<HeaderFieldRepresentation>& header_list, const Buffer& buff, bool update_table) {
-    uint32_t offset = 0, idx, name_len, value_len;
-    bool name_huff, value_huff;
-    char first;
-    Buffer name, value;
+// Puts a decoded string where a HeaderList can refer to it.
+static bool StoreString(HeaderList& header_list, const BufferView& string, bool huffman, bool is_static, BufferView& stored) {
+    uint32_t len, decoded_len;
+    char* address;
 
+    if(string.Length() == 0 || is_static == true) {
+        stored = string;
+        return true;
+    }
+
+    if(huffman == true) {
+        len = Huffman::MaxDecodedLength(string.Length());
+        address = header_list.Allocate(len);
+        if(Huffman::Decode(address, string, decoded_len) == false) return false;
+        header_list.Shrink(address, len, decoded_len);
+    }
+    else {
+        decoded_len = string.Length();
+        address = header_list.Allocate(decoded_len);
+        memcpy(address, string.Address(), decoded_len);
+    }
+
+    stored = BufferView(address, decoded_len);
+    return true;
+}
+
+// Decodes into HeaderFieldRepresentations, which own their strings. Decoding
+// into a HeaderList of views instead saves a pair of allocations per field.
+bool Table::Decode(std::vector<HeaderFieldRepresentation>& header_list, const BufferView& buff, bool update_table) {
+    uint32_t offset = 0, field_size;
     HeaderFieldRepresentation header;
+    DECODE_STATUS status;
 
     while(offset < buff.Length()) {
-        first = buff.Get(offset);
+        status = DecodeField(buff, offset, header, field_size, update_table);
+        if(status == DECODE_FIELD) header_list.push_back(header);
+        else if(status != DECODE_SIZE_UPDATE) return false;
+    }
 
-        // Indexed Header Field
-        if((first & 0x80) == 0x80) {
-            idx = DecodeInteger(buff, offset, 7);
+    return true;
+}
 
-            if(idx == 0) {
-                return false;
-            }
+bool Table::Decode(HeaderList& header_list, const BufferView& buff, bool update_table) {
+    uint32_t offset = 0, field_size;
+    DECODE_STATUS status;
 
-            if(idx < STATIC_TABLE_SIZE) {
-                header.Field().SetName(static_table[idx].Name());
-                header.Field().SetValue(static_table[idx].Value());
-            }
-            else {
-                if(idx - STATIC_TABLE_SIZE >= dynamic_table_.size()) return false;
-                header.Field().SetName(dynamic_table_[idx - STATIC_TABLE_SIZE].Name());
-                header.Field().SetValue(dynamic_table_[idx - STATIC_TABLE_SIZE].Value());
-            }
-            header.Type() = HeaderField::INDEXED_HEADER_FIELD;
-        }
-        
-        // Literal Header Field
-        else {
-            // Literal Header Field with Incremental Indexing
-            if((first & 0x40) == 0x40) {
-                idx = DecodeInteger(buff, offset, 6);
-                header.Type() = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
-            }
+    while(offset < buff.Length()) {
+        status = DecodeField(buff, offset, header_list, field_size, update_table);
+        if(status != DECODE_FIELD && status != DECODE_SIZE_UPDATE) return false;
+    }
 
-            // Maximum Dynamic Table Size Change
-            else if((first & 0x20) == 0x20) {
-                uint32_t size = DecodeInteger(buff, offset, 5);
-                UpdateSize(size);
-                continue;
-            }
+    return true;
+}
 
-            // Literal Header Field Never Indexed
-            else if((first & 0x10) == 0x10) {
-                idx = DecodeInteger(buff, offset, 4);
-                header.Type() = HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED;
-            }
+// Decodes the representation at offset (RFC 7541, 6) and moves offset past it.
+// If buff ends inside it, offset is left alone and DECODE_INCOMPLETE returned,
+// with field_size set to the least size the field can have given the lengths
+// read so far, so callers can refuse oversized fields before buffering them.
+// Otherwise field_size is the field's size as RFC 7541, 4.1 counts it.
+Table::DECODE_STATUS Table::DecodeField(const BufferView& buff, uint32_t& offset, HeaderFieldRepresentation& header, uint32_t& field_size, bool update_table) {
+    struct Representation field;
+    DECODE_STATUS status;
+    Buffer decoded;
+    uint32_t at = offset;
+    std::chrono::steady_clock::time_point start;
 
-            // Literal Header Field without Indexing
-            else {
-                idx = DecodeInteger(buff, offset, 4);
-                header.Type() = HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING;
-            }
+    if(use_stats_ == true) start = std::chrono::steady_clock::now();
 
-            if(idx > 0) {
-                if(idx < STATIC_TABLE_SIZE)
-                    header.Field().SetName(static_table[idx].Name());
-                else {
-                    if(idx - STATIC_TABLE_SIZE >= dynamic_table_.size()) return false;
-                    header.Field().SetName(dynamic_table_[idx - STATIC_TABLE_SIZE].Name);
-                }
-            }
-            else {
-                header.Field().SetNameUseHuffman((buff.Get(offset) & 128) == 128);
-                name_len = DecodeInteger(buff, offset, 7);
-                if(header.Field().NameUseHuffman() == true) {
-                    if(Huffman::GetInstance().Decode(name, Buffer(buff.Address(offset), name_len)) == false) return false;
-                    header.Field().SetName(std::string(name.Address(), name.Length()));
-                }
-                else {
-                    header.Field().SetName(std::string(buff.Address(offset), name_len));
-                }
-                offset = offset + name_len;
-            }
+    status = DecodeRepresentation(buff, offset, field, field_size);
+    if(status != DECODE_FIELD) return status;
 
-            header.Field().SetValueUseHuffman((buff.Get(offset) & 128) == 128);
-            value_len = DecodeInteger(buff, offset, 7);
-            if(header.Field().ValueUseHuffman() == true) {
-                if(Huffman::GetInstance().Decode(value, Buffer(buff.Address(offset), value_len)) == false) return false;
-                header.Field().SetValue(std::string(value.Address(), value.Length()));
-            }
-            else {
-                header.Field().SetValue(std::string(buff.Address(offset), value_len));
-            }
-            offset = offset + value_len;
+    header.Type() = field.type;
+    header.Field().SetNameUseHuffman(field.name_huffman);
+    header.Field().SetValueUseHuffman(field.value_huffman);
+
+    if(field.name_huffman == true) {
+        if(Huffman::Decode(decoded, field.name) == false) return DECODE_ERROR;
+        header.Field().SetName(decoded);
+    }
+    else {
+        header.Field().SetName(field.name);
+    }
+
+    if(field.value_huffman == true) {
+        if(Huffman::Decode(decoded, field.value) == false) return DECODE_ERROR;
+        header.Field().SetValue(decoded);
+    }
+    else {
+        header.Field().SetValue(field.value);
+    }
+
+    // Names out of either table were checked when they were literals.
+    if(validate_names_ == true && field.index == 0 && ValidHeaderName(View(header.Field().Name())) == false) return DECODE_ERROR;
+
+    if(update_table == true && header.Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING) {
+        Append(header.Field());
+    }
+
+    field_size = DynamicTable::EntrySize(header.Field().Name().length(), header.Field().Value().length());
+    if(use_stats_ == true) CountDecoded(field, offset - at, header.Field().Name().length(), header.Field().Value().length(), start);
+    return DECODE_FIELD;
+}
+
+// Same as above, appending the field to a HeaderList. Static table strings
+// are referenced, everything else is decoded or copied into the list's arena
+// before the field can evict the entries it came from.
+Table::DECODE_STATUS Table::DecodeField(const BufferView& buff, uint32_t& offset, HeaderList& header_list, uint32_t& field_size, bool update_table) {
+    struct Representation field;
+    DECODE_STATUS status;
+    BufferView name, value;
+    uint32_t at = offset;
+    std::chrono::steady_clock::time_point start;
+
+    if(use_stats_ == true) start = std::chrono::steady_clock::now();
+
+    status = DecodeRepresentation(buff, offset, field, field_size);
+    if(status != DECODE_FIELD) return status;
+
+    if(StoreString(header_list, field.name, field.name_huffman, field.name_static, name) == false) return DECODE_ERROR;
+    if(validate_names_ == true && field.index == 0 && ValidHeaderName(name) == false) return DECODE_ERROR;
+    if(StoreString(header_list, field.value, field.value_huffman, field.value_static, value) == false) return DECODE_ERROR;
+    header_list.AppendReference(field.type, name, value);
+
+    if(update_table == true && field.type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING) {
+        Append(name, value);
+    }
+
+    field_size = DynamicTable::EntrySize(name.Length(), value.Length());
+    if(use_stats_ == true) CountDecoded(field, offset - at, name.Length(), value.Length(), start);
+    return DECODE_FIELD;
+}
+
+// Counts a decoded field of encoded_len octets whose strings decoded to
+// name_len and value_len octets.
+void Table::CountDecoded(const struct Representation& field, uint32_t encoded_len, uint32_t name_len, uint32_t value_len, std::chrono::steady_clock::time_point start) {
+    stats_.fields = stats_.fields + 1;
+    if(field.type == HeaderField::INDEXED_HEADER_FIELD) stats_.indexed_fields = stats_.indexed_fields + 1;
+    else stats_.literal_fields = stats_.literal_fields + 1;
+
+    if(field.index == 0) stats_.name_literals = stats_.name_literals + 1;
+    else if(field.index < STATIC_TABLE_SIZE) stats_.static_hits = stats_.static_hits + 1;
+    else stats_.dynamic_hits = stats_.dynamic_hits + 1;
+
+    if(field.name_huffman == true) {
+        stats_.huffman_strings = stats_.huffman_strings + 1;
+        stats_.huffman_saved_bytes = stats_.huffman_saved_bytes + (int64_t)name_len - field.name.Length();
+    }
+    if(field.value_huffman == true) {
+        stats_.huffman_strings = stats_.huffman_strings + 1;
+        stats_.huffman_saved_bytes = stats_.huffman_saved_bytes + (int64_t)value_len - field.value.Length();
+    }
+
+    stats_.raw_bytes = stats_.raw_bytes + name_len + value_len;
+    stats_.encoded_bytes = stats_.encoded_bytes + encoded_len;
+    stats_.decode_nanoseconds = stats_.decode_nanoseconds + \
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Parses a representation without decoding its strings. Literal strings are
+// views into buff, still Huffman coded if so flagged, and indexed ones are
+// views into the table, valid until the dynamic table changes.
+Table::DECODE_STATUS Table::DecodeRepresentation(const BufferView& buff, uint32_t& offset, struct Representation& field, uint32_t& field_size) {
+    uint32_t at = offset, idx, size, name_len = 0, value_len;
+    uint8_t first;
+    int ret;
+
+    field.name_huffman = false;
+    field.value_huffman = false;
+    field.name_static = false;
+    field.value_static = false;
+    field.index = 0;
+
+    field_size = DYNAMIC_TABLE_ENTRY_OVERHEAD;
+    if(at >= buff.Length()) return DECODE_INCOMPLETE;
+    first = buff.Get(at);
+
+    // Indexed Header Field
+    if((first & 0x80) == 0x80) {
+        ret = DecodeInteger(buff, at, 7, idx);
+        if(ret <= 0) return (ret == 0) ? DECODE_INCOMPLETE : DECODE_ERROR;
+        if(idx == 0) return DECODE_ERROR;
+        field.index = idx;
+
+        if(idx < STATIC_TABLE_SIZE) {
+            field.name = StaticName(idx);
+            field.value = StaticValue(idx);
+            field.name_static = true;
+            field.value_static = true;
         }
+        else {
+            if(idx - STATIC_TABLE_SIZE >= dynamic_table_.Count()) return DECODE_ERROR;
+            field.name = dynamic_table_.Name(idx - STATIC_TABLE_SIZE);
+            field.value = dynamic_table_.Value(idx - STATIC_TABLE_SIZE);
+        }
+        field.type = HeaderField::INDEXED_HEADER_FIELD;
+
+        field_size = DynamicTable::EntrySize(field.name.Length(), field.value.Length());
+        offset = at;
+        return DECODE_FIELD;
+    }
+
+    // Dynamic Table Size Update
+    if((first & 0xE0) == 0x20) {
+        ret = DecodeInteger(buff, at, 5, size);
+        if(ret <= 0) return (ret == 0) ? DECODE_INCOMPLETE : DECODE_ERROR;
+        if(size > size_limit_) return DECODE_ERROR;
+        UpdateSize(size);
+        if(use_stats_ == true) stats_.size_updates = stats_.size_updates + 1;
+        field_size = 0;
+        offset = at;
+        return DECODE_SIZE_UPDATE;
+    }
+
+    // Literal Header Field with Incremental Indexing, Never Indexed or without Indexing
+    if((first & 0x40) == 0x40) {
+        ret = DecodeInteger(buff, at, 6, idx);
+        field.type = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
+    }
+    else {
+        ret = DecodeInteger(buff, at, 4, idx);
+        field.type = ((first & 0x10) == 0x10) ? HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED : HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING;
+    }
+    if(ret <= 0) return (ret == 0) ? DECODE_INCOMPLETE : DECODE_ERROR;
 
-        header_list.push_back(header);
-        if(header.Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING) {
-            AppendToTable(dynamic_table_, dynamic_table_size_max_, header.Field());
+    field.index = idx;
+    if(idx > 0) {
+        if(idx < STATIC_TABLE_SIZE) {
+            field.name = StaticName(idx);
+            field.name_static = true;
         }
+        else {
+            if(idx - STATIC_TABLE_SIZE >= dynamic_table_.Count()) return DECODE_ERROR;
+            field.name = dynamic_table_.Name(idx - STATIC_TABLE_SIZE);
+        }
+        field_size = field_size + field.name.Length();
+    }
+    else {
+        ret = DecodeStringLength(buff, at, name_len, field.name_huffman);
+        if(ret < 0) return DECODE_ERROR;
+        if(ret > 0) field_size = field_size + LeastDecodedLength(name_len, field.name_huffman);
+        if(ret == 0 || name_len > buff.Length() - at) return DECODE_INCOMPLETE;
+        field.name = buff.Slice(at, name_len);
+        at = at + name_len;
     }
 
-    return true;
+    ret = DecodeStringLength(buff, at, value_len, field.value_huffman);
+    if(ret < 0) return DECODE_ERROR;
+    if(ret > 0) field_size = field_size + LeastDecodedLength(value_len, field.value_huffman);
+    if(ret == 0 || value_len > buff.Length() - at) return DECODE_INCOMPLETE;
+    field.value = buff.Slice(at, value_len);
+    at = at + value_len;
+
+    offset = at;
+    return DECODE_FIELD;
 }
 
-void Table::Update(std::vector<HeaderFieldRepresentation> header_list) {
-    std::vector<HeaderFieldRepresentation>::iterator it = header_list.begin();
+void Table::Update(const std::vector<HeaderFieldRepresentation>& header_list) {
+    std::vector<HeaderFieldRepresentation>::const_iterator it = header_list.begin();
     for(; it != header_list.end(); it++) {
         if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING) {
             Append(it->Field());
@@ -331,23 +928,229 @@ void Table::Update(std::vector<HeaderFieldRepresentation> header_list) {
     }
 }
 
+// Applies a size the peer's encoder signalled. An encoder uses SetMaxSize().
 void Table::UpdateSize(uint32_t size) {
-    dynamic_table_size_max_ = size;
-    while(dynamic_table_.size() > dynamic_table_size_max_) {
-        dynamic_table_.pop_back();
+    while(dynamic_table_.Size() > size) {
+        Evict();
     }
+    dynamic_table_.SetMaxSize(size);
+    generation_ = generation_ + 1;
+}
+
+// Resizes an encoder's table. Entries that no longer fit are evicted now, as
+// the peer evicts them on reading the smallest size of those signalled.
+// The change is signalled at the start of the next block encoded with the
+// table updated: the least size set since the last block if it was below
+// the final one, then the final size (RFC 7541, 4.2).
+void Table::SetMaxSize(uint32_t size) {
+    if(size_update_pending_ == false && size == dynamic_table_.MaxSize()) return;
+
+    if(size_update_pending_ == false || size < size_update_min_) size_update_min_ = size;
+    size_update_pending_ = true;
+    UpdateSize(size);
+}
+
+bool Table::SizeUpdatePending() const {
+    return size_update_pending_;
+}
+
+// Bounds the sizes a decoder accepts, our SETTINGS_HEADER_TABLE_SIZE. A size
+// update above it fails to decode.
+void Table::SetSizeLimit(uint32_t limit) {
+    size_limit_ = limit;
 }
 
 void Table::Print() {
-    for(uint32_t i = 0; i < dynamic_table_.size(); i++) {
-        std::cout << "(" << STATIC_TABLE_SIZE + i << ") " << dynamic_table_[i].Name() << ":" << dynamic_table_[i].Value() << std::endl;
+    BufferView name, value;
+
+    for(uint32_t i = 0; i < dynamic_table_.Count(); i++) {
+        name = dynamic_table_.Name(i);
+        value = dynamic_table_.Value(i);
+        std::cout << "(" << STATIC_TABLE_SIZE + i << ") " << std::string(name.Address() != nullptr ? name.Address() : "", name.Length()) << ":" << std::string(value.Address() != nullptr ? value.Address() : "", value.Length()) << std::endl;
+    }
+    std::cout << "size " << dynamic_table_.Size() << "/" << dynamic_table_.MaxSize() << std::endl;
+}
+
+// Returns the index of an entry matching both name and value, setting value_matched,
+// or else the index of an entry matching the name only, or 0 if there is none.
+// Static entries are preferred over dynamic ones.
+//
+// Lookups go through hashed indexes by name and by name and value, a prebuilt
+// one for the static table and one kept for the dynamic table, so no entry is
+// scanned or copied. Dynamic entries are indexed by insertion sequence number,
+// which stays valid while newer entries shift their HPACK index.
+uint32_t Table::Find(const BufferView& name, const BufferView& value, bool& value_matched) {
+    std::unordered_map<uint64_t, uint64_t>::const_iterator dynamic_it;
+    uint64_t name_hash = HashBytes(name), field_hash = HashField(name_hash, value);
+    uint32_t idx;
+
+    if(indexed_ == false) BuildIndex();
+
+    value_matched = true;
+
+    idx = StaticFieldIndex(field_hash, name, value);
+    if(idx != 0) return idx;
+
+    dynamic_it = field_index_.find(field_hash);
+    if(dynamic_it != field_index_.end()) {
+        idx = DynamicIndex(dynamic_it->second);
+        if(dynamic_table_.Name(idx - STATIC_TABLE_SIZE).Equals(name) && dynamic_table_.Value(idx - STATIC_TABLE_SIZE).Equals(value)) return idx;
+    }
+
+    value_matched = false;
+
+    idx = StaticNameIndex(name_hash, name);
+    if(idx != 0) return idx;
+
+    dynamic_it = name_index_.find(name_hash);
+    if(dynamic_it != name_index_.end()) {
+        idx = DynamicIndex(dynamic_it->second);
+        if(dynamic_table_.Name(idx - STATIC_TABLE_SIZE).Equals(name)) return idx;
     }
+
+    return 0;
+}
+
+Table::HUFFMAN_MODE Table::HuffmanMode() const {
+    return huffman_mode_;
+}
+
+// How Encode() writes string literals. HUFFMAN_FIELD follows the flags of each
+// HeaderField, HUFFMAN_NEVER and HUFFMAN_ALWAYS ignore them, and
+// HUFFMAN_ADAPTIVE picks whichever of the Huffman coded and raw strings is
+// shorter. HUFFMAN_LATENCY is adaptive too, but sends long values raw without
+// encoding them if a sample of them shows they would not shrink by a quarter,
+// as with tokens and base64 blobs.
+void Table::SetHuffmanMode(HUFFMAN_MODE mode) {
+    huffman_mode_ = mode;
+    generation_ = generation_ + 1;
+}
+
+// Encode() reuses the block it produced for the same header list as long as
+// the dynamic table has not changed since.
+void Table::UseBlockCache(bool use) {
+    use_block_cache_ = use;
+    if(use == false) block_cache_.Clear();
+}
+
+const BlockCache* Table::GetBlockCache() const {
+    return use_block_cache_ ? &block_cache_ : nullptr;
+}
+
+IndexingPolicy* Table::GetIndexingPolicy() const {
+    return indexing_policy_;
+}
+
+// The policy decides which fields Encode() adds to the table, instead of the
+// types the caller gave. Blocks cached under the previous policy may not be
+// what this one encodes.
+void Table::SetIndexingPolicy(IndexingPolicy* policy) {
+    indexing_policy_ = policy;
+    generation_ = generation_ + 1;
+}
+
+const Dictionary* Table::GetDictionary() const {
+    return dictionary_;
+}
+
+// Warm starts the table with the fields of the dictionary, which the table
+// does not own.
+void Table::SetDictionary(const Dictionary* dictionary) {
+    dictionary_ = dictionary;
+    generation_ = generation_ + 1;
+}
+
+// Decode() fails on a literal header name that is not a valid HTTP/2 name,
+// see ValidHeaderName().
+void Table::UseNameValidation(bool use) {
+    validate_names_ = use;
+}
+
+// Counts what the table encodes or decodes and how long that takes, see
+// TableStats. Off by default, as timing costs a clock read per block or field.
+void Table::UseStats(bool use) {
+    use_stats_ = use;
+}
+
+// Returns a copy of the counters with the dynamic table as it is now.
+TableStats Table::Stats() const {
+    TableStats stats = stats_;
+
+    stats.table_size = dynamic_table_.Size();
+    stats.table_max_size = dynamic_table_.MaxSize();
+    stats.table_entries = dynamic_table_.Count();
+    return stats;
+}
+
+void Table::ResetStats() {
+    stats_ = TableStats();
 }
 
 void Table::Append(HeaderField header) {
-    AppendToTable(dynamic_table_, dynamic_table_size_max_, header);
+    Append(View(header.Name()), View(header.Value()));
 }
 
-uint32_t Table::Find(const std::string name, const std::string value) {
-    return FindFromTable(dynamic_table_, name, value);
-}
\ No newline at end of file
+void Table::Append(const BufferView& name, const BufferView& value) {
+    uint32_t size = DynamicTable::EntrySize(name.Length(), value.Length());
+
+    // Evict here rather than in the dynamic table so the index follows.
+    while(dynamic_table_.Count() > 0 && dynamic_table_.Size() + size > dynamic_table_.MaxSize()) {
+        Evict();
+    }
+
+    generation_ = generation_ + 1;
+    if(dynamic_table_.Insert(name, value) == false) return;
+    if(use_stats_ == true) stats_.insertions = stats_.insertions + 1;
+
+    if(indexed_ == true) {
+        uint64_t name_hash = HashBytes(name);
+        name_index_[name_hash] = dynamic_table_.Inserted() - 1;
+        field_index_[HashField(name_hash, value)] = dynamic_table_.Inserted() - 1;
+    }
+}
+
+// Removes the oldest entry. Index slots still pointing at it are dropped,
+// since no newer entry has the same key.
+void Table::Evict() {
+    uint32_t oldest = dynamic_table_.Count() - 1;
+
+    if(dynamic_table_.Count() == 0) return;
+
+    if(indexed_ == true) {
+        uint64_t seq = dynamic_table_.Inserted() - dynamic_table_.Count();
+        uint64_t name_hash = HashBytes(dynamic_table_.Name(oldest));
+        uint64_t field_hash = HashField(name_hash, dynamic_table_.Value(oldest));
+        std::unordered_map<uint64_t, uint64_t>::iterator it;
+
+        it = name_index_.find(name_hash);
+        if(it != name_index_.end() && it->second == seq) name_index_.erase(it);
+        it = field_index_.find(field_hash);
+        if(it != field_index_.end() && it->second == seq) field_index_.erase(it);
+    }
+
+    dynamic_table_.Evict();
+    generation_ = generation_ + 1;
+    if(use_stats_ == true) stats_.evictions = stats_.evictions + 1;
+}
+
+// Only tables used for encoding are indexed. The index is built on the first
+// lookup and kept up to date from then on.
+void Table::BuildIndex() {
+    uint64_t seq, name_hash;
+
+    name_index_.clear();
+    field_index_.clear();
+
+    for(uint32_t i = dynamic_table_.Count(); i > 0; i--) {
+        seq = dynamic_table_.Inserted() - i;
+        name_hash = HashBytes(dynamic_table_.Name(i - 1));
+        name_index_[name_hash] = seq;
+        field_index_[HashField(name_hash, dynamic_table_.Value(i - 1))] = seq;
+    }
+
+    indexed_ = true;
+}
+
+uint32_t Table::DynamicIndex(const uint64_t seq) const {
+    return STATIC_TABLE_SIZE + (uint32_t)(dynamic_table_.Inserted() - 1 - seq);
+}
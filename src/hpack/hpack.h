@@ -4,12 +4,27 @@
 #define STATIC_TABLE_SIZE 62
 #define DYNAMIC_TABLE_SIZE_MAX 4096
 
+// In HUFFMAN_LATENCY mode, values at least this long are checked for entropy
+// on a sample of this many bytes before they are Huffman coded.
+#define HUFFMAN_LATENCY_LENGTH 64
+#define HUFFMAN_LATENCY_SAMPLE 32
+
+// Encoded header blocks remembered by a Table that uses a block cache.
+#define HEADER_BLOCK_CACHE_SLOTS 64
+
 #include <vector>
 #include <string>
+#include <chrono>
+#include <unordered_map>
+#include <stdint.h>
 
-#include "../buffer/Buffer.h"
+#include "../buffer/buffer.h"
+#include "dynamic_table.h"
 
 namespace hpack {
+    class HeaderList;
+    class IndexingPolicy;
+
     struct HeaderField {
         public:
             typedef enum _HEADER_FIELD_TYPE {
@@ -34,6 +49,8 @@ namespace hpack {
 
             void SetName(const std::string name);
             void SetValue(const std::string value);
+            void SetName(const BufferView& name);
+            void SetValue(const BufferView& value);
 
         private:
             bool name_use_huffman_;
@@ -46,28 +63,243 @@ namespace hpack {
         public:
             HeaderField& Field();
             HeaderField::HEADER_FIELD_TYPE& Type();
+            const HeaderField& Field() const;
+            HeaderField::HEADER_FIELD_TYPE Type() const;
 
         private:
             HeaderField header_field_;
             HeaderField::HEADER_FIELD_TYPE type_;
     };
 
+    /*
+        ### Table statistics ###
+        Counters a Table keeps once UseStats() is on. A table either encodes
+        or decodes, so each counter describes the direction it is used in.
+
+        Fields are counted by representation: indexed fields reference a
+        whole entry, literal fields carry their value and reference a name,
+        or carry that too when name_literals counts them. Static and dynamic
+        hits count both kinds of references. Raw bytes are the octets of
+        names and values, encoded bytes those of the header block, and
+        Huffman saved bytes what Huffman coding took off the literal strings.
+        Blocks are only counted by encoders, and only those encoded with the
+        table updated, which are the ones sent. Blocks encoded just to learn
+        a frame's length count for nothing. Blocks reused from the block
+        cache add to raw and encoded bytes but not to the field counters.
+
+        table_size, table_max_size and table_entries describe the dynamic
+        table when the snapshot was taken.
+    */
+    struct TableStats {
+        uint64_t blocks = 0;
+        uint64_t cached_blocks = 0;
+        uint64_t fields = 0;
+        uint64_t indexed_fields = 0;
+        uint64_t literal_fields = 0;
+        uint64_t name_literals = 0;
+        uint64_t static_hits = 0;
+        uint64_t dynamic_hits = 0;
+        uint64_t huffman_strings = 0;
+        int64_t huffman_saved_bytes = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+        uint64_t size_updates = 0;
+        uint64_t raw_bytes = 0;
+        uint64_t encoded_bytes = 0;
+        uint64_t encode_nanoseconds = 0;
+        uint64_t decode_nanoseconds = 0;
+
+        uint32_t table_size = 0;
+        uint32_t table_max_size = 0;
+        uint32_t table_entries = 0;
+    };
+
+    /*
+        ### Header block cache ###
+        Direct mapped memo of encoded header blocks, keyed by a hash of the
+        header list and the generation of the table that encoded it. The
+        generation changes whenever the dynamic table does, so a block found
+        for the current generation is exactly what encoding the list again
+        would produce.
+
+        Reusing a block must also leave the table as encoding would have.
+        Blocks that add fields to the table are therefore only reused where
+        the table is not updated. Once those fields are in the table, the
+        list encodes to a block of indexes that is reused from then on.
+    */
+    class BlockCache {
+    public:
+        BlockCache();
+
+        const Buffer* Find(const uint64_t key, const HeaderFieldRepresentation* headers, const size_t count, const uint64_t generation, const bool update);
+        void Store(const uint64_t key, const HeaderFieldRepresentation* headers, const size_t count, const uint64_t generation, const bool inserts, const BufferView& block);
+        void Clear();
+
+        uint64_t Hits() const;
+        uint64_t Misses() const;
+
+    private:
+        struct Entry {
+            bool valid = false;
+            bool inserts = false;
+            uint64_t key = 0;
+            uint64_t generation = 0;
+            std::vector<HeaderFieldRepresentation> header_list;
+            Buffer block;
+        };
+
+        std::vector<Entry> entries_;
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+    };
+
+    /*
+        ### Dictionary ###
+        Header fields that are known to repeat on every connection, such as
+        the user-agent or authority a proxy sends to its backends. An encoder
+        with a dictionary indexes these fields whenever they are sent and are
+        not in its table, whatever type or indexing policy says otherwise,
+        unless they are to be never indexed. So the first header block of a
+        connection already fills its table with them.
+
+        Each field is encoded once, when it is added, as a literal with
+        incremental indexing that does not depend on the dynamic table, its
+        strings Huffman coded in the HUFFMAN_ADAPTIVE way. Tables in that
+        mode, the one Connection uses, send this encoding. Tables in other
+        modes still index the fields but encode them as they would any
+        other, so a table set to HUFFMAN_NEVER sends them raw. A dictionary
+        is built before use and then only read, so one can be shared by
+        every connection.
+    */
+    class Dictionary {
+    public:
+        Dictionary();
+
+        bool Add(const std::string& name, const std::string& value);
+        const Buffer* Find(const BufferView& name, const BufferView& value) const;
+        uint32_t Count() const;
+
+    private:
+        struct Entry {
+            std::string name;
+            std::string value;
+            Buffer encoded;
+        };
+
+        std::vector<Entry> entries_;
+        std::unordered_map<uint64_t, uint32_t> index_;
+    };
+
+    /*
+        ### Table ###
+        Static and dynamic header table of one direction of a connection.
+        An encoder and a decoder must each use their own Table.
+
+        The dynamic table size is counted in octets as RFC 7541 defines it,
+        DYNAMIC_TABLE_SIZE_MAX by default. Tables used for encoding also keep
+        a hashed index of it, see Find(). Everything else an encoder or a
+        decoder can be set up with, from the Huffman mode to statistics, is
+        described where it is set.
+    */
     class Table {
     public:
-        bool Encode(Buffer& encoded_buffer, std::vector<HeaderFieldRepresentation> header_list, bool update_table = true);
-        bool Decode(std::vector<HeaderFieldRepresentation>& header_list, const Buffer& buff, bool update_table = true);
+        typedef enum _DECODE_STATUS {
+            DECODE_FIELD = 0,
+            DECODE_SIZE_UPDATE,
+            DECODE_INCOMPLETE,
+            DECODE_ERROR,
+        } DECODE_STATUS;
+
+        typedef enum _HUFFMAN_MODE {
+            HUFFMAN_FIELD = 0,
+            HUFFMAN_NEVER,
+            HUFFMAN_ALWAYS,
+            HUFFMAN_ADAPTIVE,
+            HUFFMAN_LATENCY,
+        } HUFFMAN_MODE;
+
+        Table();
+        Table(uint32_t dynamic_table_size_max);
 
-        void Update(std::vector<HeaderFieldRepresentation> header_list);
+        bool Encode(Buffer& encoded_buffer, const std::vector<HeaderFieldRepresentation>& header_list, bool update_table = true);
+        bool Encode(Buffer& out, const HeaderFieldRepresentation* headers, const size_t count, bool update_table = true);
+        bool Decode(std::vector<HeaderFieldRepresentation>& header_list, const BufferView& buff, bool update_table = true);
+        bool Decode(HeaderList& header_list, const BufferView& buff, bool update_table = true);
+        DECODE_STATUS DecodeField(const BufferView& buff, uint32_t& offset, HeaderFieldRepresentation& header, uint32_t& field_size, bool update_table = true);
+        DECODE_STATUS DecodeField(const BufferView& buff, uint32_t& offset, HeaderList& header_list, uint32_t& field_size, bool update_table = true);
+
+        void Update(const std::vector<HeaderFieldRepresentation>& header_list);
         void UpdateSize(uint32_t size);
+        void SetMaxSize(uint32_t size);
+        bool SizeUpdatePending() const;
+        void SetSizeLimit(uint32_t limit);
+
+        uint32_t Find(const BufferView& name, const BufferView& value, bool& value_matched);
+
+        HUFFMAN_MODE HuffmanMode() const;
+        void SetHuffmanMode(HUFFMAN_MODE mode);
+
+        void UseBlockCache(bool use);
+        const BlockCache* GetBlockCache() const;
+
+        IndexingPolicy* GetIndexingPolicy() const;
+        void SetIndexingPolicy(IndexingPolicy* policy);
+
+        const Dictionary* GetDictionary() const;
+        void SetDictionary(const Dictionary* dictionary);
+
+        void UseNameValidation(bool use);
+
+        void UseStats(bool use);
+        TableStats Stats() const;
+        void ResetStats();
 
         void Print();
 
     private:
+        struct Representation {
+            HeaderField::HEADER_FIELD_TYPE type;
+            BufferView name;
+            BufferView value;
+            bool name_huffman;
+            bool value_huffman;
+            bool name_static;
+            bool value_static;
+            uint32_t index;
+        };
+
+        DECODE_STATUS DecodeRepresentation(const BufferView& buff, uint32_t& offset, struct Representation& field, uint32_t& field_size);
+        void EncodeSizeUpdate(Buffer& out);
+        bool EncodeBlock(Buffer& out, const HeaderFieldRepresentation* headers, const size_t count, bool update_table, bool& inserts);
+        void CountDecoded(const struct Representation& field, uint32_t encoded_len, uint32_t name_len, uint32_t value_len, std::chrono::steady_clock::time_point start);
         void Append(HeaderField header);
-        uint32_t Find(const std::string name, const std::string value = "");
+        void Append(const BufferView& name, const BufferView& value);
+        void Evict();
+        void BuildIndex();
+        uint32_t DynamicIndex(const uint64_t seq) const;
+
+        DynamicTable dynamic_table_;
+        HUFFMAN_MODE huffman_mode_ = HUFFMAN_FIELD;
+        uint64_t generation_ = 0;
+
+        bool size_update_pending_ = false;
+        uint32_t size_update_min_ = 0;
+        uint32_t size_limit_ = UINT32_MAX;
+
+        bool use_block_cache_ = false;
+        BlockCache block_cache_;
+
+        IndexingPolicy* indexing_policy_ = nullptr;
+        const Dictionary* dictionary_ = nullptr;
+
+        bool validate_names_ = false;
+
+        bool use_stats_ = false;
+        TableStats stats_;
 
-        uint32_t dynamic_table_size_max_;
-        std::vector<HeaderField> dynamic_table_;
+        bool indexed_ = false;
+        std::unordered_map<uint64_t, uint64_t> name_index_;
+        std::unordered_map<uint64_t, uint64_t> field_index_;
     };
 }
 
@@ -1,9 +1,15 @@
 #include <queue>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <arpa/inet.h>
 
 #include "huffman.h"
 
 using namespace hpack;
 
+struct Huffman::node Huffman::root_;
+
 struct HuffmanCode {
     uint32_t code;
     uint8_t code_len;
@@ -92,6 +98,8 @@ Huffman::Huffman() {
         }
         cur->value = i;
     }
+
+    BuildDecodeTable();
 }
 
 Huffman::~Huffman() {
@@ -102,46 +110,174 @@ Huffman::~Huffman() {
 
     while(!s.empty()) {
         struct node* cur = s.front();
+        s.pop();
         if(cur->left != nullptr) s.push(cur->left);
         if(cur->right != nullptr) s.push(cur->right);
         delete cur;
     }
 }
 
+void Huffman::BuildDecodeTable() {
+    std::vector<struct node*> states;
+    std::vector<int> ones;
+    struct node* cur;
+    std::size_t i;
+    int nibble, bit, symbol;
+    uint8_t flags;
+
+    // Number the internal nodes breadth first, so the root is state 0. ones
+    // counts the bits of a node reached from the root by 1 bits only, -1 for
+    // any other node. A state accepts the end of the string if it is reached
+    // by at most seven 1 bits, i.e. by valid padding.
+    root_.state = 0;
+    states.push_back(&root_);
+    ones.push_back(0);
+    for(i = 0; i < states.size(); i++) {
+        struct node* children[2] = { states[i]->left, states[i]->right };
+        for(bit = 0; bit < 2; bit++) {
+            if(children[bit] == nullptr || children[bit]->value != -1) continue;
+            children[bit]->state = states.size();
+            states.push_back(children[bit]);
+            ones.push_back((bit == 1 && ones[i] >= 0) ? ones[i] + 1 : -1);
+        }
+    }
+
+    for(i = 0; i < states.size(); i++) {
+        for(nibble = 0; nibble < 16; nibble++) {
+            cur = states[i];
+            flags = 0;
+            symbol = 0;
+
+            for(bit = 3; bit >= 0; bit--) {
+                cur = (((nibble >> bit) & 1) == 1) ? cur->right : cur->left;
+
+                if(cur == nullptr || cur->value == 256) {
+                    flags = DECODE_FAIL;
+                    break;
+                }
+                if(cur->value != -1) {
+                    flags = flags | DECODE_SYMBOL;
+                    symbol = cur->value;
+                    cur = &root_;
+                }
+            }
+
+            if((flags & DECODE_FAIL) == 0 && ones[cur->state] >= 0 && ones[cur->state] <= 7) {
+                flags = flags | DECODE_ACCEPT;
+            }
+
+            decode_table_[i][nibble].state = (flags & DECODE_FAIL) ? 0 : cur->state;
+            decode_table_[i][nibble].flags = flags;
+            decode_table_[i][nibble].symbol = symbol;
+        }
+    }
+}
+
 Huffman& Huffman::GetInstance() {
     static Huffman instance;
     return instance;
 }
 
-bool Huffman::Encode(Buffer& target, const Buffer& string) {
-    int i, append_remain = 8, cur_remain;
-    char cur_ch, append_ch = 0xFF;
+uint32_t Huffman::EncodedLength(const BufferView& string) {
+    const uint8_t* in = (const uint8_t*)string.Address();
+    uint64_t bit_len = 0;
 
-    target.Clear();
+    for(unsigned int i = 0; i < string.Length(); i++) {
+        bit_len = bit_len + huffman_codes[in[i]].code_len;
+    }
 
-    for(i = 0; i < string.Length(); i++) {
-        cur_ch = string.Get(i);
-        cur_remain = huffman_codes[cur_ch].code_len;
-        while(cur_remain > 0) {
-            if(cur_remain >= append_remain) {
-                append_ch = append_ch & (cur_ch >> (cur_remain - append_remain));
-                cur_remain = cur_remain - append_remain;
-                target.Append(append_ch);
-                append_remain = 8;
-                append_ch = 0xFF;
-            }
-            else {
-                append_ch = append_ch & (cur_ch << (append_remain - cur_remain));
-                cur_remain = 0;
-                append_remain = append_remain - cur_remain;
-            }
+    return (uint32_t)((bit_len + 7) / 8);
+}
+
+// Writes exactly EncodedLength(string) bytes to out and returns that count.
+uint32_t Huffman::Encode(char* out, const BufferView& string) {
+    const uint8_t* in = (const uint8_t*)string.Address();
+    uint64_t bits = 0;
+    uint32_t word, out_len = 0;
+    int bit_len = 0;
+
+    // Pending bits are kept at the top of the accumulator. Fewer than 32 are
+    // left after every flush and no code is longer than 30 bits, so a code
+    // always fits without checking.
+    for(unsigned int i = 0; i < string.Length(); i++) {
+        const struct HuffmanCode& code = huffman_codes[in[i]];
+        bits = bits | ((uint64_t)code.code << (64 - bit_len - code.code_len));
+        bit_len = bit_len + code.code_len;
+
+        if(bit_len >= 32) {
+            word = htonl((uint32_t)(bits >> 32));
+            memcpy(out + out_len, &word, 4);
+            out_len = out_len + 4;
+            bits = bits << 32;
+            bit_len = bit_len - 32;
+        }
+    }
+
+    // Pad with the most significant bits of EOS.
+    if(bit_len > 0) {
+        bits = bits | (~(uint64_t)0 >> bit_len);
+        for(; bit_len > 0; bit_len = bit_len - 8) {
+            out[out_len++] = (char)(bits >> 56);
+            bits = bits << 8;
         }
     }
 
+    return out_len;
+}
+
+bool Huffman::Encode(Buffer& target, const BufferView& string) {
+    uint32_t len = EncodedLength(string);
+
+    target.Resize(len);
+    if(len > 0) Encode(&target[0], string);
+
     return true;
 }
 
-bool Huffman::Decode(Buffer& target, const Buffer& code) {
+// The shortest code is five bits, which bounds the decoded length.
+uint32_t Huffman::MaxDecodedLength(const uint32_t code_len) {
+    return (uint32_t)((uint64_t)code_len * 8 / 5);
+}
+
+// Writes the decoded string to out, which must have room for
+// MaxDecodedLength() bytes, and sets decoded_len to its length.
+bool Huffman::Decode(char* out, const BufferView& code, uint32_t& decoded_len) {
+    const struct DecodeTransition (*table)[16] = GetInstance().decode_table_;
+    const uint8_t* in = (const uint8_t*)code.Address();
+    unsigned int len = code.Length(), i, out_len = 0;
+    uint8_t state = 0;
+    bool accept = true;
+
+    for(i = 0; i < len; i++) {
+        const struct DecodeTransition& high = table[state][in[i] >> 4];
+        if(high.flags & DECODE_FAIL) return false;
+        if(high.flags & DECODE_SYMBOL) out[out_len++] = (char)high.symbol;
+
+        const struct DecodeTransition& low = table[high.state][in[i] & 0xF];
+        if(low.flags & DECODE_FAIL) return false;
+        if(low.flags & DECODE_SYMBOL) out[out_len++] = (char)low.symbol;
+
+        state = low.state;
+        accept = (low.flags & DECODE_ACCEPT) != 0;
+    }
+
+    decoded_len = out_len;
+
+    return accept;
+}
+
+bool Huffman::Decode(Buffer& target, const BufferView& code) {
+    uint32_t decoded_len = 0;
+    bool decoded;
+
+    target.Resize(MaxDecodedLength(code.Length()) + 1);
+    decoded = Decode(&target[0], code, decoded_len);
+    target.Resize(decoded_len);
+
+    return decoded;
+}
+
+bool Huffman::DecodeTree(Buffer& target, const BufferView& code) {
     int i;
     uint8_t mask;
     struct node* cur = &root_;
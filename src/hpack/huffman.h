@@ -3,16 +3,44 @@
 
 #include <stdint.h>
 
-#include "../buffer/Buffer.h"
+#include "../buffer/buffer.h"
 
 #define HUFFMAN_CODE_SIZE 257
 
+// The code tree has one less internal node than symbols, so 256 decoder states.
+#define HUFFMAN_DECODE_STATES 256
+
 namespace hpack {
+    /*
+        ### Huffman ###
+        Static Huffman code of RFC 7541, Appendix B.
+
+        Encode() packs codes into a 64-bit accumulator and stores 32 bits at
+        a time. EncodedLength() sums the code lengths only, so callers can
+        compare the result with the raw length and reserve exactly the space
+        the encoded string takes before encoding it.
+
+        Decode() is a finite state machine that consumes four bits per step.
+        Its states are the internal nodes of the code tree, and a transition
+        table built once from the tree gives, for every state and nibble, the
+        next state and the symbol completed on the way, if any. No code is
+        shorter than five bits, so a nibble completes at most one symbol.
+
+        A string is rejected if it contains EOS, or if its padding is longer
+        than seven bits or is not a prefix of EOS (RFC 7541, 5.2).
+        DecodeTree() is the former bit-at-a-time tree walker. It is kept as a
+        reference for benchmarks and does not check padding.
+    */
     class Huffman {
     public:
         static Huffman& GetInstance();
-        static bool Encode(Buffer& encoded_buffer, const Buffer& string);
-        static bool Decode(Buffer& decoded_buffer, const Buffer& code);
+        static uint32_t EncodedLength(const BufferView& string);
+        static uint32_t Encode(char* out, const BufferView& string);
+        static bool Encode(Buffer& encoded_buffer, const BufferView& string);
+        static uint32_t MaxDecodedLength(const uint32_t code_len);
+        static bool Decode(char* out, const BufferView& code, uint32_t& decoded_len);
+        static bool Decode(Buffer& decoded_buffer, const BufferView& code);
+        static bool DecodeTree(Buffer& decoded_buffer, const BufferView& code);
 
         Huffman(Huffman const&) = delete;
         void operator=(Huffman const&) = delete;
@@ -24,9 +52,25 @@ namespace hpack {
         struct node {
             struct node *left = nullptr, *right = nullptr;
             int value = -1;
+            int state = -1;
+        };
+
+        enum DECODE_FLAG {
+            DECODE_SYMBOL = 0x1,    // a symbol was completed
+            DECODE_ACCEPT = 0x2,    // the string may end in the next state
+            DECODE_FAIL = 0x4,      // EOS or an invalid code
+        };
+
+        struct DecodeTransition {
+            uint8_t state;
+            uint8_t flags;
+            uint8_t symbol;
         };
-        
+
+        void BuildDecodeTable();
+
         static struct node root_;
+        struct DecodeTransition decode_table_[HUFFMAN_DECODE_STATES][16];
     };
 }
 
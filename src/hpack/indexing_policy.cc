@@ -0,0 +1,102 @@
+#include <cctype>
+#include <cstring>
+
+#include "indexing_policy.h"
+#include "hash.h"
+
+using namespace hpack;
+
+static bool Indexes(const HeaderField::HEADER_FIELD_TYPE type) {
+    return type == HeaderField::INDEXED_HEADER_FIELD || type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
+}
+
+IndexingPolicy::~IndexingPolicy() {
+}
+
+bool IndexingPolicy::Stateless() const {
+    return true;
+}
+
+HeaderField::HEADER_FIELD_TYPE AlwaysIndexPolicy::Decide(const BufferView&, const BufferView&, HeaderField::HEADER_FIELD_TYPE type, bool, bool) {
+    if(type == HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED) return type;
+    return HeaderField::INDEXED_HEADER_FIELD;
+}
+
+NeverIndexLargeValuesPolicy::NeverIndexLargeValuesPolicy(uint32_t max_value_length) : max_value_length_(max_value_length) {
+}
+
+HeaderField::HEADER_FIELD_TYPE NeverIndexLargeValuesPolicy::Decide(const BufferView&, const BufferView& value, HeaderField::HEADER_FIELD_TYPE type, bool in_table, bool) {
+    if(in_table == false && Indexes(type) == true && value.Length() > max_value_length_) {
+        return HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING;
+    }
+    return type;
+}
+
+FrequencyIndexPolicy::FrequencyIndexPolicy(uint32_t repeats, uint32_t slots) : repeats_(repeats), slots_(slots > 0 ? slots : 1) {
+}
+
+// Fields already in the table were admitted before and are not counted, nor
+// are fields of blocks that are only measured.
+HeaderField::HEADER_FIELD_TYPE FrequencyIndexPolicy::Decide(const BufferView& name, const BufferView& value, HeaderField::HEADER_FIELD_TYPE type, bool in_table, bool update) {
+    uint64_t key;
+    uint32_t count;
+
+    if(in_table == true || Indexes(type) == false) return type;
+
+    key = HashField(HashBytes(name), value);
+    Slot& slot = slots_[key % slots_.size()];
+    count = (slot.key == key) ? slot.count : 0;
+    if(count < repeats_) count = count + 1;
+
+    if(update == true) {
+        slot.key = key;
+        slot.count = count;
+    }
+
+    return (count >= repeats_) ? type : HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING;
+}
+
+bool FrequencyIndexPolicy::Stateless() const {
+    return false;
+}
+
+void FrequencyIndexPolicy::Clear() {
+    for(size_t i = 0; i < slots_.size(); i++) {
+        slots_[i].key = 0;
+        slots_[i].count = 0;
+    }
+}
+
+SensitiveHeaderPolicy::SensitiveHeaderPolicy(IndexingPolicy* next) : next_(next) {
+    names_.push_back("authorization");
+    names_.push_back("proxy-authorization");
+    names_.push_back("cookie");
+    names_.push_back("set-cookie");
+}
+
+HeaderField::HEADER_FIELD_TYPE SensitiveHeaderPolicy::Decide(const BufferView& name, const BufferView& value, HeaderField::HEADER_FIELD_TYPE type, bool in_table, bool update) {
+    for(size_t i = 0; i < names_.size(); i++) {
+        if(name.Length() == names_[i].length() && memcmp(name.Address(), names_[i].data(), name.Length()) == 0) {
+            return HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED;
+        }
+    }
+
+    if(next_ != nullptr) return next_->Decide(name, value, type, in_table, update);
+    return type;
+}
+
+bool SensitiveHeaderPolicy::Stateless() const {
+    return next_ == nullptr || next_->Stateless() == true;
+}
+
+// HTTP/2 header names are lower case, so names are stored that way.
+void SensitiveHeaderPolicy::AddName(const std::string& name) {
+    std::string lower = name;
+
+    for(size_t i = 0; i < lower.length(); i++) lower[i] = (char)tolower((unsigned char)lower[i]);
+    names_.push_back(lower);
+}
+
+void SensitiveHeaderPolicy::ClearNames() {
+    names_.clear();
+}
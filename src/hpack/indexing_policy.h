@@ -0,0 +1,111 @@
+#ifndef _HPACK_INDEXING_POLICY_H_
+#define _HPACK_INDEXING_POLICY_H_
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "../buffer/buffer.h"
+#include "hpack.h"
+
+// Values longer than this are not indexed by NeverIndexLargeValuesPolicy.
+#define INDEXING_LARGE_VALUE_LENGTH 128
+
+// Fields FrequencyIndexPolicy keeps a count for, and how often one has to be
+// seen before it is indexed.
+#define INDEXING_FREQUENCY_SLOTS 1024
+#define INDEXING_FREQUENCY_REPEATS 2
+
+namespace hpack {
+    /*
+        ### Indexing policy ###
+        Decides how an encoding Table represents each field, in place of the
+        HEADER_FIELD_TYPE the caller gave it. Decide() is passed that type and
+        whether the field is in the table already, and returns the type to
+        encode it with. update is false when the block is only encoded to be
+        measured, as HeadersFrame does to learn its length before the block
+        is sent. The policy must then decide as it would for the block that
+        is sent, but without changing any state of its own.
+
+        Fields that are in the table are sent as an index unless the policy
+        returns LITERAL_HEADER_FIELD_WITHOUT_INDEXING or _NEVER_INDEXED. For
+        the others, INDEXED_HEADER_FIELD and _WITH_INCREMENTAL_INDEXING add
+        them to the table, so a policy that keeps one-off values such as
+        request ids out of it stops them from evicting entries that repeat.
+
+        A policy that is not stateless may decide differently for the same
+        field and table, so its table does not reuse cached header blocks.
+        Policies are not owned by the Table they are set on.
+    */
+    class IndexingPolicy {
+    public:
+        virtual ~IndexingPolicy();
+
+        virtual HeaderField::HEADER_FIELD_TYPE Decide(const BufferView& name, const BufferView& value, HeaderField::HEADER_FIELD_TYPE type, bool in_table, bool update) = 0;
+        virtual bool Stateless() const;
+    };
+
+    // Indexes every field the caller did not mark as never indexed.
+    class AlwaysIndexPolicy : public IndexingPolicy {
+    public:
+        HeaderField::HEADER_FIELD_TYPE Decide(const BufferView& name, const BufferView& value, HeaderField::HEADER_FIELD_TYPE type, bool in_table, bool update) override;
+    };
+
+    // Leaves fields with long values out of the table, as they take a lot of
+    // it and rarely repeat.
+    class NeverIndexLargeValuesPolicy : public IndexingPolicy {
+    public:
+        NeverIndexLargeValuesPolicy(uint32_t max_value_length = INDEXING_LARGE_VALUE_LENGTH);
+
+        HeaderField::HEADER_FIELD_TYPE Decide(const BufferView& name, const BufferView& value, HeaderField::HEADER_FIELD_TYPE type, bool in_table, bool update) override;
+
+    private:
+        uint32_t max_value_length_;
+    };
+
+    /*
+        Indexes a field only once it has been seen repeats times. Counts are
+        kept in a direct mapped array of slots, so a field that shares its
+        slot with another may have to start counting again.
+    */
+    class FrequencyIndexPolicy : public IndexingPolicy {
+    public:
+        FrequencyIndexPolicy(uint32_t repeats = INDEXING_FREQUENCY_REPEATS, uint32_t slots = INDEXING_FREQUENCY_SLOTS);
+
+        HeaderField::HEADER_FIELD_TYPE Decide(const BufferView& name, const BufferView& value, HeaderField::HEADER_FIELD_TYPE type, bool in_table, bool update) override;
+        bool Stateless() const override;
+        void Clear();
+
+    private:
+        struct Slot {
+            uint64_t key = 0;
+            uint32_t count = 0;
+        };
+
+        uint32_t repeats_;
+        std::vector<Slot> slots_;
+    };
+
+    /*
+        Sends the fields named in the list as never indexed, so neither this
+        encoder nor any intermediary puts credentials in a table where they
+        could be probed for. Other fields are left to the next policy, or to
+        the caller if there is none.
+    */
+    class SensitiveHeaderPolicy : public IndexingPolicy {
+    public:
+        SensitiveHeaderPolicy(IndexingPolicy* next = nullptr);
+
+        HeaderField::HEADER_FIELD_TYPE Decide(const BufferView& name, const BufferView& value, HeaderField::HEADER_FIELD_TYPE type, bool in_table, bool update) override;
+        bool Stateless() const override;
+
+        void AddName(const std::string& name);
+        void ClearNames();
+
+    private:
+        IndexingPolicy* next_;
+        std::vector<std::string> names_;
+    };
+}
+
+#endif
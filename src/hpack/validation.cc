@@ -0,0 +1,55 @@
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "validation.h"
+
+// Adding these to a byte maps the valid range, and the upper case letters,
+// to the bottom of the signed byte range, where one compare finds them.
+#define NAME_RANGE_BIAS 0x5F
+#define NAME_RANGE_LAST (-128 + 0x7E - 0x21)
+#define UPPER_RANGE_BIAS 0x3F
+#define UPPER_RANGE_LAST (-128 + 'Z' - 'A')
+
+static bool ValidNameByte(const uint8_t byte) {
+    return byte >= 0x21 && byte <= 0x7E && (byte < 'A' || byte > 'Z');
+}
+
+bool hpack::ValidHeaderName(const BufferView& name) {
+    const uint8_t* p = (const uint8_t*)name.Address();
+    const uint8_t* end = p + name.Length();
+
+    if(name.Length() == 0) return false;
+
+#if defined(__AVX2__)
+    const __m256i name_bias = _mm256_set1_epi8(NAME_RANGE_BIAS), name_last = _mm256_set1_epi8(NAME_RANGE_LAST);
+    const __m256i upper_bias = _mm256_set1_epi8(UPPER_RANGE_BIAS), upper_first = _mm256_set1_epi8(UPPER_RANGE_LAST + 1);
+
+    for(; end - p >= 32; p = p + 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)p);
+        __m256i outside = _mm256_cmpgt_epi8(_mm256_add_epi8(bytes, name_bias), name_last);
+        __m256i upper = _mm256_cmpgt_epi8(upper_first, _mm256_add_epi8(bytes, upper_bias));
+        if(_mm256_movemask_epi8(_mm256_or_si256(outside, upper)) != 0) return false;
+    }
+#elif defined(__SSE2__)
+    const __m128i name_bias = _mm_set1_epi8(NAME_RANGE_BIAS), name_last = _mm_set1_epi8(NAME_RANGE_LAST);
+    const __m128i upper_bias = _mm_set1_epi8(UPPER_RANGE_BIAS), upper_first = _mm_set1_epi8(UPPER_RANGE_LAST + 1);
+
+    for(; end - p >= 16; p = p + 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)p);
+        __m128i outside = _mm_cmpgt_epi8(_mm_add_epi8(bytes, name_bias), name_last);
+        __m128i upper = _mm_cmplt_epi8(_mm_add_epi8(bytes, upper_bias), upper_first);
+        if(_mm_movemask_epi8(_mm_or_si128(outside, upper)) != 0) return false;
+    }
+#endif
+
+    for(; p < end; p++) {
+        if(ValidNameByte(*p) == false) return false;
+    }
+
+    return true;
+}
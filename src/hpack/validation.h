@@ -0,0 +1,21 @@
+#ifndef _HPACK_VALIDATION_H_
+#define _HPACK_VALIDATION_H_
+
+#include "../buffer/buffer.h"
+
+namespace hpack {
+    /*
+        ### Header name validation ###
+        HTTP/2 header names are non-empty tokens in lower case (RFC 9113,
+        8.2.1), so a valid name is at least one visible ASCII character,
+        0x21 to 0x7E, with no upper case letter. Pseudo-header names pass
+        too, ':' being one of those characters.
+
+        Names are checked 32 or 16 bytes at a time when the build targets
+        AVX2 or SSE2, and a byte at a time otherwise and for what is left
+        over.
+    */
+    bool ValidHeaderName(const BufferView& name);
+}
+
+#endif